@@ -0,0 +1,310 @@
+#include "Raycast.h"
+#include "VisibilityPolygon.h"
+#include "JobSystem.h"
+
+#include <rapidjson/document.h>
+#include <rapidjson/filereadstream.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Primitives2D;
+
+namespace
+{
+    // Every benchmark repeats until it has run for at least this long
+    constexpr double MIN_BENCH_SECONDS = 0.25;
+    constexpr int MAX_ITERATIONS = 100000;
+
+    constexpr int LINE_COUNT = 1024;
+    constexpr int RAY_TARGET_COUNT = 256;
+    constexpr float ENEMY_FOV = 60.0f;
+
+    // Casting at every vertex is quadratic in the rect count,
+    // larger environments are only used with --full
+    constexpr size_t MAX_CAST_RECTS = 10000;
+
+    struct Environment
+    {
+        std::string name;
+        std::vector<Rect> rects;
+        Vec2 worldSize;
+    };
+
+    struct BenchResult
+    {
+        int iterations = 0;
+        double meanNs = 0.0;
+        double minNs = 0.0;
+    };
+
+    //-----------------------------------------------------------------------------
+    // Calls function until it has run for MIN_BENCH_SECONDS, setup is called
+    // before every iteration and is not timed
+    //-----------------------------------------------------------------------------
+    template <typename Setup, typename Function>
+    BenchResult Run(const Setup& setup, const Function& function)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        BenchResult result;
+        double totalNs = 0.0;
+
+        while (result.iterations < MAX_ITERATIONS && (result.iterations == 0 || totalNs < MIN_BENCH_SECONDS * 1e9))
+        {
+            setup();
+
+            Clock::time_point start = Clock::now();
+            function();
+            double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+            if (result.iterations == 0 || ns < result.minNs) result.minNs = ns;
+            totalNs += ns;
+            result.iterations++;
+        }
+
+        result.meanNs = totalNs / result.iterations;
+        return result;
+    }
+
+    //-----------------------------------------------------------------------------
+    // Scatters rects of random size over a square world that grows with the
+    // rect count, so density stays roughly the same for every size
+    //-----------------------------------------------------------------------------
+    Environment CreateSyntheticEnvironment(size_t rectCount, uint32_t seed)
+    {
+        Environment environment;
+        environment.name = "synthetic_" + std::to_string(rectCount);
+
+        const float worldSide = 200.0f * std::sqrt(static_cast<float>(rectCount));
+        environment.worldSize = Vec2(worldSide, worldSide);
+
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> position(0.0f, worldSide);
+        std::uniform_real_distribution<float> size(10.0f, 60.0f);
+
+        environment.rects.reserve(rectCount);
+        for (size_t i = 0; i < rectCount; i++)
+            environment.rects.emplace_back(Vec2(position(rng), position(rng)), size(rng), size(rng));
+
+        return environment;
+    }
+
+    //-----------------------------------------------------------------------------
+    // Reads the walls of a level file, other objects don't affect raycasts
+    //-----------------------------------------------------------------------------
+    bool LoadLevelEnvironment(const std::filesystem::path& filepath, Environment& environment)
+    {
+        using namespace rapidjson;
+
+        FILE* file = fopen(filepath.string().c_str(), "rb");
+        if (file == nullptr)
+        {
+            std::cerr << "Failed to open " << filepath << '\n';
+            return false;
+        }
+
+        char readBuffer[65536];
+        FileReadStream inputStream(file, readBuffer, sizeof(readBuffer));
+
+        Document document;
+        document.ParseStream(inputStream);
+        fclose(file);
+
+        if (document.HasParseError() || !document.HasMember("walls"))
+        {
+            std::cerr << "Failed to parse " << filepath << '\n';
+            return false;
+        }
+
+        environment.name = filepath.stem().string();
+        environment.worldSize = Vec2(1920.0f, 1080.0f);
+
+        const Value& walls = document["walls"];
+        for (size_t i = 0; i < walls.Size(); i++)
+        {
+            const Value& wall = walls[i];
+            environment.rects.emplace_back(
+                Vec2(wall["x"].GetInt(), wall["y"].GetInt()),
+                wall["width"].GetInt(),
+                wall["height"].GetInt()
+            );
+        }
+
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+    // Prints a single result as a JSON object
+    //-----------------------------------------------------------------------------
+    void PrintResult(bool& first, const char* benchmark, const Environment& environment, const BenchResult& result, const char* unit, double unitsPerIteration)
+    {
+        printf("%s\n    { \"benchmark\": \"%s\", \"environment\": \"%s\", \"rects\": %zu, \"iterations\": %d, "
+               "\"mean_ns\": %.1f, \"min_ns\": %.1f, \"%s\": %.0f, \"mean_ns_per_unit\": %.3f }",
+            first ? "" : ",",
+            benchmark, environment.name.c_str(), environment.rects.size(), result.iterations,
+            result.meanNs, result.minNs, unit, unitsPerIteration,
+            unitsPerIteration > 0.0 ? result.meanNs / unitsPerIteration : 0.0);
+
+        first = false;
+        fflush(stdout);
+    }
+
+    //-----------------------------------------------------------------------------
+    // Runs every benchmark on a single environment
+    //-----------------------------------------------------------------------------
+    void BenchEnvironment(const Environment& environment, bool full, bool& first)
+    {
+        const std::vector<Rect>& rects = environment.rects;
+        const Vec2 center = environment.worldSize / 2.0f;
+
+        std::cerr << "Running " << environment.name << '\n';
+
+        // Random lines and targets inside the world, same for every run
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> x(0.0f, environment.worldSize.x);
+        std::uniform_real_distribution<float> y(0.0f, environment.worldSize.y);
+
+        std::vector<LineSegment> lines;
+        lines.reserve(LINE_COUNT);
+        for (int i = 0; i < LINE_COUNT; i++)
+            lines.emplace_back(x(rng), y(rng), x(rng), y(rng));
+
+        std::vector<Vec2> targets;
+        targets.reserve(RAY_TARGET_COUNT);
+        for (int i = 0; i < RAY_TARGET_COUNT; i++)
+            targets.emplace_back(x(rng), y(rng));
+
+        // Keeps the optimizer from removing the collision checks
+        volatile int hitCount = 0;
+
+        // CheckLineRectCollision, every line against every rect
+        BenchResult result = Run([] {}, [&]
+        {
+            int hits = 0;
+            for (const LineSegment& line : lines)
+                for (const Rect& rect : rects)
+                    hits += CheckLineRectCollision(line, rect).result;
+            hitCount = hits;
+        });
+        PrintResult(first, "CheckLineRectCollision", environment, result, "rect_tests", static_cast<double>(lines.size() * rects.size()));
+
+        // FindClosestIntersection, reached through CastRayToPos like the shotgun does
+        Raycast raycast;
+        result = Run([&] { raycast.ResetRays(); }, [&]
+        {
+            for (const Vec2& target : targets)
+                raycast.CastRayToPos(center, target, rects, true);
+        });
+        PrintResult(first, "FindClosestIntersection", environment, result, "rays", static_cast<double>(targets.size()));
+
+        if (rects.size() > MAX_CAST_RECTS && !full) return;
+
+        // CastRaysAtVertices with the same fov as enemies
+        const Vec2 fovCenter = center + Vec2(1.0f, 0.0f);
+        result = Run([] {}, [&]
+        {
+            raycast.CastRaysAtVertices(center, rects, fovCenter, ENEMY_FOV);
+        });
+        PrintResult(first, "CastRaysAtVertices", environment, result, "rays", static_cast<double>(raycast.GetRayCount()));
+
+        // SortRays on a fresh copy of the unsorted cast every iteration
+        const Raycast unsorted = raycast;
+        Raycast sorted;
+        result = Run([&] { sorted = unsorted; }, [&]
+        {
+            sorted.SortRays();
+        });
+        PrintResult(first, "SortRays", environment, result, "rays", static_cast<double>(unsorted.GetRayCount()));
+
+        // VisibilityPolygon::Build, what the player's sight costs every frame the player moves
+        StaticGrid grid;
+        grid.Build({ std::span<const Rect>(rects), {}, {}, {} });
+        VisibilityPolygon polygon;
+        polygon.SetWalls(rects, grid);
+        result = Run([] {}, [&]
+        {
+            polygon.Build(center);
+        });
+        PrintResult(first, "VisibilityPolygon::Build", environment, result, "points", static_cast<double>(polygon.GetPointCount()));
+
+        // VisibilityPolygon::IsVisible, what replaced casting rays for every enemy sight check
+        result = Run([] {}, [&]
+        {
+            int visible = 0;
+            for (const Vec2& target : targets)
+                visible += polygon.IsVisible(target);
+            hitCount = visible;
+        });
+        PrintResult(first, "VisibilityPolygon::IsVisible", environment, result, "points", static_cast<double>(targets.size()));
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Benchmarks the geometry core and prints results as JSON to stdout
+// Usage: GeometryBench [--full] [--threads N] [--levels DIR]
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    bool full = false;
+    int threads = 1;
+    std::filesystem::path levelDirectory = "./levels";
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--full") == 0) full = true;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--levels") == 0 && i + 1 < argc) levelDirectory = argv[++i];
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--full] [--threads N] [--levels DIR]" << '\n';
+            return 1;
+        }
+    }
+
+    // Without Init every ParallelFor runs inline on this thread, Init only
+    // takes the extra workers since this thread is worker 0
+    if (threads > 1) JobSystem::GetInstance().Init(threads - 1);
+
+    std::vector<Environment> environments;
+    for (size_t rectCount : { 10, 100, 1000, 10000, 100000 })
+        environments.push_back(CreateSyntheticEnvironment(rectCount, static_cast<uint32_t>(rectCount)));
+
+    // Shipped levels, sorted so the output order is stable
+    std::vector<std::filesystem::path> levelFiles;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(levelDirectory, error))
+    {
+        if (entry.path().extension() == ".json") levelFiles.push_back(entry.path());
+    }
+    std::sort(levelFiles.begin(), levelFiles.end());
+
+    if (levelFiles.empty()) std::cerr << "No levels found in " << levelDirectory << '\n';
+
+    for (const std::filesystem::path& filepath : levelFiles)
+    {
+        Environment environment;
+        if (LoadLevelEnvironment(filepath, environment)) environments.push_back(std::move(environment));
+    }
+
+    printf("{\n  \"suite\": \"GeometryBench\",\n  \"threads\": %d,\n  \"full\": %s,\n  \"results\": [",
+        JobSystem::GetInstance().GetThreadCount() > 0 ? JobSystem::GetInstance().GetThreadCount() : 1,
+        full ? "true" : "false");
+
+    bool first = true;
+    for (const Environment& environment : environments)
+        BenchEnvironment(environment, full, first);
+
+    printf("\n  ]\n}\n");
+
+    JobSystem::GetInstance().Destroy();
+    return 0;
+}
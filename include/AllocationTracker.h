@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Counts heap allocations made through operator new when built with
+// ENABLE_ALLOC_TRACKER, which replaces the global operator new/delete
+// Allocations are attributed to the innermost profiler zone, so build with
+// ENABLE_PROFILER as well to get more than "(no zone)"
+// SDL allocates with its own allocator and isn't counted
+namespace AllocationTracker
+{
+	struct FrameAllocations
+	{
+		uint64_t count = 0;
+		uint64_t bytes = 0;
+	};
+
+	struct ZoneAllocations
+	{
+		const char* zone = nullptr;
+		uint64_t count = 0;
+		uint64_t bytes = 0;
+	};
+
+	bool IsEnabled();
+
+	// Returns and resets allocations made since last call
+	FrameAllocations EndFrame();
+
+	// Copies allocations per zone of the frame ended by the last EndFrame()
+	size_t GetFrameZones(ZoneAllocations* zones, size_t maxZones);
+
+	void RecordAllocation(size_t size);
+}
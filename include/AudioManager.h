@@ -1,8 +1,8 @@
 #pragma once
 
-#include <SDL3_mixer/SDL_mixer.h>
+#include "AudioMixer.h"
 #include <iostream>
-#include <vector>
+#include <string>
 
 enum class AudioEnum
 {
@@ -28,19 +28,24 @@ public:
 	void UnloadAudio(AudioEnum audioID);
 	void UnloadAllAudio();
 
-	int Play(AudioEnum audioID);
-	void Stop(int channel);
+	uint32_t Play(AudioEnum audioID);
+	void Stop(uint32_t playID);
 	void Stop(AudioEnum audioID);
 	void StopAll();
 
+	const AudioMixer& GetMixer() const { return m_mixer; }
+
 private:
-	AudioManager()  = default;//: m_audioChunks{};
+	AudioManager()  = default;
 	~AudioManager() = default;
 
-	Mix_Chunk* m_audioChunks[static_cast<int>(AudioEnum::AUDIO_ENUM_COUNT)];
+	AudioMixer m_mixer;
+	AudioSample m_samples[static_cast<int>(AudioEnum::AUDIO_ENUM_COUNT)];
+	std::atomic<uint32_t> m_reportedDrops{ 0 };
 
 private:
 	std::string GetAudioFilepath(AudioEnum audioID) const;
+	AudioPriority GetAudioPriority(AudioEnum audioID) const;
 
 	// Prevent copy and assignment
 	AudioManager(const AudioManager&)            = delete;
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "SPSCQueue.h"
+#include <SDL3/SDL.h>
+#include <atomic>
+#include <vector>
+
+// Decides which voices can be stolen when every voice is in use,
+// a voice can only steal from voices with the same or lower priority
+enum class AudioPriority : uint8_t
+{
+	Low = 0,
+	Normal,
+	High,
+	Critical
+};
+
+// Sample data converted to the mixers format when loaded,
+// interleaved stereo float32 at the device sample rate
+struct AudioSample
+{
+	std::vector<float> data;
+	uint32_t frameCount = 0;
+
+	bool IsLoaded() const { return frameCount > 0; }
+};
+
+struct Voice
+{
+	const AudioSample* sample = nullptr;
+	uint32_t position = 0; // In frames
+	uint32_t playID = 0;   // Increases with every play, so also used as start order
+	float gain = 1.0f;
+	int group = -1;
+	AudioPriority priority = AudioPriority::Low;
+	bool looping = false;
+	bool active = false;
+};
+
+enum class AudioCommandType : uint8_t
+{
+	Play,
+	StopVoice,
+	StopGroup,
+	StopAll
+};
+
+// Posted by gameplay threads and applied by the audio thread
+// before mixing the next buffer
+struct AudioCommand
+{
+	AudioCommandType type = AudioCommandType::StopAll;
+	AudioPriority priority = AudioPriority::Low;
+	bool looping = false;
+	int group = -1;
+	uint32_t playID = 0;
+	float gain = 1.0f;
+	const AudioSample* sample = nullptr;
+};
+
+class AudioMixer
+{
+public:
+	AudioMixer()  = default;
+	~AudioMixer() = default;
+
+	bool Init();
+	void Destroy();
+
+	bool LoadSample(const char* filepath, AudioSample& sample) const;
+
+	uint32_t PlayVoice(const AudioSample& sample, int group, AudioPriority priority, bool looping, float gain = 1.0f);
+	void StopVoice(uint32_t playID);
+	void StopGroup(int group);
+	void StopAllVoices();
+	void StopSample(const AudioSample& sample);
+
+	// Fraction of the audio buffer duration spent mixing, 1.0 means the callback can't keep up
+	float GetCallbackLoad()      const { return m_callbackLoad.load(std::memory_order_relaxed); }
+	float GetPeakCallbackLoad()  const { return m_peakCallbackLoad.load(std::memory_order_relaxed); }
+	int GetActiveVoiceCount()    const { return m_activeVoiceCount.load(std::memory_order_relaxed); }
+	uint32_t GetStolenCount()    const { return m_stolenCount.load(std::memory_order_relaxed); }
+	uint32_t GetDroppedCount()   const { return m_droppedCount.load(std::memory_order_relaxed) + m_overflowCount.load(std::memory_order_relaxed); }
+
+public:
+	static constexpr int MAX_VOICES = 32;
+	static constexpr int CHANNELS = 2;
+	static constexpr int MIX_CHUNK_FRAMES = 512;
+
+	// Every thread that posts commands gets its own queue
+	static constexpr int MAX_PRODUCER_THREADS = 32;
+	static constexpr size_t COMMAND_QUEUE_SIZE = 128;
+
+private:
+	SDL_AudioStream* m_stream = nullptr;
+	SDL_AudioSpec m_spec = { SDL_AUDIO_F32, CHANNELS, 48000 };
+
+	// Only touched by the audio thread, or while holding the stream lock
+	Voice m_voices[MAX_VOICES];
+	alignas(16) float m_mixBuffer[MIX_CHUNK_FRAMES * CHANNELS];
+
+	SPSCQueue<AudioCommand, COMMAND_QUEUE_SIZE> m_commandQueues[MAX_PRODUCER_THREADS];
+	std::atomic<int> m_producerCount{ 0 };
+	std::atomic<uint32_t> m_playCounter{ 0 };
+	std::atomic<uint32_t> m_overflowCount{ 0 };
+
+	// Written by audio thread
+	std::atomic<uint32_t> m_stolenCount{ 0 };
+	std::atomic<uint32_t> m_droppedCount{ 0 };
+	std::atomic<float> m_callbackLoad{ 0.0f };
+	std::atomic<float> m_peakCallbackLoad{ 0.0f };
+	std::atomic<int> m_activeVoiceCount{ 0 };
+
+private:
+	static void SDLCALL AudioCallback(void* userdata, SDL_AudioStream* stream, int additionalAmount, int totalAmount);
+	bool PushCommand(const AudioCommand& command);
+	void ApplyCommands();
+	void StartVoice(const AudioCommand& command);
+	void MixChunk(int frameCount);
+	int FindVoiceToSteal(AudioPriority priority) const;
+};
@@ -1,9 +1,13 @@
 #pragma once
 
 #include "Player.h"
+#include "EntityStore.h"
+#include "FlowField.h"
+#include "PerceptionScheduler.h"
+#include "PerceptionEvents.h"
 #include <unordered_map>
 
-enum class EnemyStates
+enum class EnemyStates : uint8_t
 {
     Idle,
     Normal,
@@ -12,61 +16,96 @@ enum class EnemyStates
     Deactivated
 };
 
-enum class EnemyTypes
+enum class EnemyTypes : uint8_t
 {
     Fast,
     Brute,
     Boss,
-    Tutorial
+    Tutorial,
+    ENEMY_TYPES_COUNT
 };
 
 // Forward declaration of game
 class Game;
 
-class Enemy
+// Everything every update pass reads, hitbox center is the enemy position
+// Kept at 32 bytes so two enemies share a cache line
+struct EnemyBody
 {
-public:
-    Enemy(EnemyTypes type, const Primitives2D::LineSegment& path, uint16_t ID, Game* pGame);
-    ~Enemy() = default;
+    Primitives2D::Circle hitbox;
+    Vec2 velocity;
+    Vec2 targetPosition;
+    EnemyStates currentState = EnemyStates::Normal;
+    EnemyTypes type = EnemyTypes::Fast;
+};
 
-    const Primitives2D::Circle& GetHitbox() const { return m_hitbox; }
+static_assert(sizeof(EnemyBody) == 32, "EnemyBody should stay half a cache line");
 
-    void Update(float deltaTime, 
-        const Player& player, 
-        const std::vector<Primitives2D::Rect>& environment,
-        const Shotgun& playerShotgun);
-    void Render() const;
+// Where the enemy was before the last simulation step, only used to
+// interpolate rendering between steps
+struct EnemyPreviousPosition
+{
+    Vec2 center;
+};
 
-public:
-    static const std::unordered_map<std::string, EnemyTypes> enemyMap;
-    bool isDead;
+// Only touched when the state machine changes state or the enemy is hit
+struct EnemyBrain
+{
+    Primitives2D::LineSegment path;
+    float idleTimer = 0.0f;
+    int health = 0;
+    uint32_t ID = 0;
+    EnemyStates lastState = EnemyStates::Normal;
+};
 
-private:
-    Primitives2D::Circle m_hitbox;
-    Raycast m_sight;
-    Vec2 m_velocity;
-    Vec2 m_position;
-    Vec2 m_targetPosition;
-    Primitives2D::LineSegment m_path;
-    EnemyStates m_currentState;
-    EnemyStates m_lastState;
-    Game* m_pGame;
+// When the enemy last looked for the player, see PerceptionScheduler and
+// PerceptionEvents
+struct EnemyPerception
+{
+    uint16_t stepsUntilSight = 0;   // Sight checks run when this is 0
+    uint16_t meshStepsWaited = 0;   // Steps the sight mesh was deferred for
+    bool canSeePlayer = false;      // Result of the last sight check
+    bool isMeshDue = false;         // Sight mesh is recast after every sight check
+    bool wasInPlayerSight = false;  // Enemy's sector was in the player's sight last step
+};
 
-    float m_walkingSpeed;
-    float m_chasingSpeed;
-    float m_fov = 60.0f;
-    float m_idleTimer;
-    float m_idleTime;
-    uint16_t m_ID;
-    int m_health;
+// Stats shared by every enemy of a type, see Enemies::GetArchetype()
+struct EnemyArchetype
+{
+    float hitboxRadius;
+    float walkingSpeed;
+    float chasingSpeed;
+    int health;
+    float idleTime;
+    float fov;
+    EnemyStates startState;
+};
+
+// Sight raycast is its own component, it's only cast and rendered
+using EnemyStore = EntityStore<EnemyBody, EnemyBrain, EnemyPreviousPosition, EnemyPerception, Raycast>;
 
-private:
-    bool CheckIfSeesPlayer(const Player& player, const std::vector<Primitives2D::Rect>& environment);
+namespace Enemies
+{
+    extern const std::unordered_map<std::string, EnemyTypes> enemyMap;
 
-    void FollowPath(float deltaTime, float speed);
-    void Idle(float deltaTime);
-    void ChasePlayer(float deltaTime, const Vec2& playerPos);
+    const EnemyArchetype& GetArchetype(EnemyTypes type);
 
-    bool HasReachedTarget() const { return (m_position - m_targetPosition).Length() <= 2.0f; }
-    void SetStats(float hitboxRadius, float walkingSpeed, float chasingSpeed, int health, float idleTime, float fov);
-};
+    EntityHandle Spawn(EnemyStore& enemies,
+        EnemyTypes type,
+        const Primitives2D::LineSegment& path,
+        uint32_t ID,
+        std::pmr::memory_resource* sightMemory);
+
+    void Update(EnemyStore& enemies,
+        float deltaTime,
+        const Player& player,
+        std::span<const Primitives2D::Rect> environment,
+        const Shotgun& playerShotgun,
+        EnemyGrid& enemyGrid,
+        const VisibilityPolygon& playerSight,
+        FlowField& flowField,
+        PerceptionScheduler& scheduler,
+        PerceptionEvents& events,
+        Game* pGame);
+    void Render(const EnemyStore& enemies, float alpha);
+}
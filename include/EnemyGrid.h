@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Primitives2D.h"
+#include <memory_resource>
+
+struct EnemyBody;
+
+// Spatial hash over every enemy hitbox, rebuilt each simulation step since
+// enemies move every step. Cells are hashed into a fixed number of buckets,
+// so enemies can walk anywhere and the grid never has to be resized
+// Enemies are stored by their index in the EnemyStore, indices are valid
+// until enemies are moved, added or removed
+class EnemyGrid
+{
+public:
+    explicit EnemyGrid(std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+    ~EnemyGrid() = default;
+
+    // Makes room for enemyCount enemies so rebuilding never allocates
+    void Reserve(size_t enemyCount);
+    void Build(std::span<const EnemyBody> bodies);
+
+    // Indices of every enemy whose hitbox bounds overlap area, each only
+    // once, valid until the next query
+    std::span<const uint32_t> Query(const Primitives2D::Rect& area);
+
+    // Indices of every enemy line hits, walks the cells along line so only
+    // enemies near it are tested, valid until the next query
+    std::span<const uint32_t> QueryLine(const Primitives2D::LineSegment& line);
+
+    const Primitives2D::Circle& GetHitbox(uint32_t index) const { return m_hitboxes[index]; }
+
+private:
+    static constexpr float m_CELL_SIZE = 64.0f;
+    static constexpr uint32_t m_BUCKET_COUNT = 1024; // Has to be a power of 2
+
+    std::pmr::vector<Primitives2D::Circle> m_hitboxes; // Copy of every hitbox, by index
+    std::pmr::vector<uint32_t> m_bucketStart;          // Where each bucket's enemies start in m_items
+    std::pmr::vector<uint32_t> m_items;
+    std::pmr::vector<uint32_t> m_queryStamps;          // Last query that visited each enemy
+    std::pmr::vector<uint32_t> m_results;
+    uint32_t m_queryStamp = 0;
+
+private:
+    static int ToCell(float position) { return static_cast<int>(std::floor(position / m_CELL_SIZE)); }
+    static uint32_t GetBucket(int column, int row);
+
+    void NextQuery();
+    template <typename Test>
+    void VisitBucket(uint32_t bucket, Test&& test);
+};
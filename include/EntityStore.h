@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Refers to one entity in an EntityStore, stays valid while other entities
+// are added and removed, IsAlive() turns false once the entity is removed
+struct EntityHandle
+{
+	uint32_t slot = UINT32_MAX;
+	uint32_t generation = 0;
+
+	bool operator==(const EntityHandle& other) const = default;
+};
+
+//-----------------------------------------------------------------------------
+// Removes element index in O(1) by moving the last element into its place,
+// for lists where order doesn't matter
+//-----------------------------------------------------------------------------
+template <typename Vector>
+void SwapAndPop(Vector& vector, size_t index)
+{
+	if (index + 1 != vector.size())
+		vector[index] = std::move(vector.back());
+	vector.pop_back();
+}
+
+// Every component type is kept in its own tightly packed array and entity i
+// is at index i in all of them, so loops only stream the components they use
+// Removing an entity moves the last one into its place
+template <typename... Components>
+class EntityStore
+{
+	static_assert(sizeof...(Components) > 0, "EntityStore needs at least one component");
+
+public:
+	explicit EntityStore(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+		: m_components(std::pmr::vector<Components>(memory)...)
+		, m_slots(memory)
+		, m_entitySlots(memory)
+		, m_freeSlots(memory)
+	{
+	}
+
+	size_t Size() const { return m_entitySlots.size(); }
+
+	//-----------------------------------------------------------------------------
+	// Components are looked up by type, so each type can only be used once
+	//-----------------------------------------------------------------------------
+	template <typename Component>
+	std::span<Component> Get() { return std::get<std::pmr::vector<Component>>(m_components); }
+
+	template <typename Component>
+	std::span<const Component> Get() const { return std::get<std::pmr::vector<Component>>(m_components); }
+
+	//-----------------------------------------------------------------------------
+	// Adds an entity at the end of every array, reuses the slot of a removed
+	// entity with a newer generation so old handles to it stay invalid
+	//-----------------------------------------------------------------------------
+	EntityHandle Add(Components... components)
+	{
+		uint32_t slot;
+		if (!m_freeSlots.empty())
+		{
+			slot = m_freeSlots.back();
+			m_freeSlots.pop_back();
+		}
+		else
+		{
+			slot = static_cast<uint32_t>(m_slots.size());
+			m_slots.push_back(Slot());
+		}
+
+		m_slots[slot].index = static_cast<uint32_t>(m_entitySlots.size());
+		m_entitySlots.push_back(slot);
+		(std::get<std::pmr::vector<Components>>(m_components).push_back(std::move(components)), ...);
+
+		return { slot, m_slots[slot].generation };
+	}
+
+	//-----------------------------------------------------------------------------
+	// Swap-and-pop, the last entity takes index's place, so loops that remove
+	// while iterating should go backwards
+	//-----------------------------------------------------------------------------
+	void RemoveAt(size_t index)
+	{
+		const uint32_t slot = m_entitySlots[index];
+		const uint32_t lastSlot = m_entitySlots.back();
+
+		(SwapAndPop(std::get<std::pmr::vector<Components>>(m_components), index), ...);
+		SwapAndPop(m_entitySlots, index);
+
+		m_slots[lastSlot].index = static_cast<uint32_t>(index);
+		m_slots[slot].generation++;
+		m_freeSlots.push_back(slot);
+	}
+
+	void Remove(EntityHandle handle)
+	{
+		if (IsAlive(handle)) RemoveAt(m_slots[handle.slot].index);
+	}
+
+	bool IsAlive(EntityHandle handle) const
+	{
+		return handle.slot < m_slots.size() && m_slots[handle.slot].generation == handle.generation;
+	}
+
+	// Only valid for handles that are alive
+	size_t GetIndex(EntityHandle handle) const { return m_slots[handle.slot].index; }
+	EntityHandle GetHandle(size_t index) const { return { m_entitySlots[index], m_slots[m_entitySlots[index]].generation }; }
+
+	void Reserve(size_t count)
+	{
+		(std::get<std::pmr::vector<Components>>(m_components).reserve(count), ...);
+		m_slots.reserve(count);
+		m_entitySlots.reserve(count);
+	}
+
+private:
+	struct Slot
+	{
+		uint32_t index = 0;      // Where the entity currently is in the arrays
+		uint32_t generation = 0; // Bumped every time the entity in this slot is removed
+	};
+
+	std::tuple<std::pmr::vector<Components>...> m_components;
+	std::pmr::vector<Slot> m_slots;
+	std::pmr::vector<uint32_t> m_entitySlots; // Slot of the entity at each index
+	std::pmr::vector<uint32_t> m_freeSlots;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Primitives2D.h"
+#include <memory_resource>
+
+// Navigation grid over a level's walls with the shortest path from every
+// cell to a target, built once by LoadLevel
+// Paths are only recomputed when the target moves into another cell, so
+// every chasing enemy just looks up the next cell on its path
+class FlowField
+{
+public:
+    explicit FlowField(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : m_walls(memory), m_blocked(memory), m_distances(memory), m_nextCells(memory), m_open(memory) {}
+    ~FlowField() = default;
+
+    void Build(std::span<const Primitives2D::Rect> walls);
+    void SetTarget(const Vec2& target);
+
+    // Where an enemy at position should walk to next to reach the target,
+    // the target itself when there's no path or it's close
+    Vec2 GetWaypoint(const Vec2& position);
+
+private:
+    static constexpr float m_MIN_CELL_SIZE = 32.0f;
+    static constexpr size_t m_MAX_CELLS = 256 * 256;
+    static constexpr int m_BORDER_CELLS = 2;          // Free cells around the walls so enemies can walk around the level
+    static constexpr uint32_t m_UNREACHED = UINT32_MAX;
+    static constexpr uint32_t m_STRAIGHT_COST = 10;
+    static constexpr uint32_t m_DIAGONAL_COST = 14;
+
+    std::pmr::vector<Primitives2D::Rect> m_walls; // Tested when the target cell touches a wall
+    std::pmr::vector<uint8_t> m_blocked;    // Cells that overlap a wall
+    std::pmr::vector<uint32_t> m_distances; // Path cost from each cell to the target cell
+    std::pmr::vector<int32_t> m_nextCells;  // Next cell on the path, -1 for the target and unreached cells
+    std::pmr::vector<uint64_t> m_open;      // Heap of distance << 32 | cell
+
+    Vec2 m_target;
+    int m_targetCell = -1;
+    bool m_isDirty = false;
+
+    Vec2 m_origin;
+    float m_cellSize = m_MIN_CELL_SIZE;
+    int m_columns = 0;
+    int m_rows = 0;
+
+private:
+    int GetCell(const Vec2& position) const;
+    Vec2 GetCellCenter(int cell) const;
+    bool CanSeeTarget(int cell) const;
+    void ComputePaths();
+};
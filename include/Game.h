@@ -3,47 +3,140 @@
 #include "Player.h"
 #include "Enemy.h"
 #include "Text.h"
+#include "PerfOverlay.h"
+#include "InputRecording.h"
+#include "AllocationTracker.h"
+#include "MemoryArena.h"
+#include "WorldState.h"
 #include <SDL3/SDL.h>
+#include <string>
 
 constexpr uint8_t TEXT_BUFFER_SIZE = 10;
 
+enum class RunMode
+{
+	Play,
+	Record,   // Plays normally and saves input to recordingPath on exit
+	Replay,   // Replays recordingPath headless as fast as possible
+	AllocCheck // Idles headless on startLevelID and fails if a steady state frame allocates
+};
+
+struct LaunchOptions
+{
+	RunMode mode = RunMode::Play;
+	std::string recordingPath;
+	bool hasSeed = false;
+	uint32_t seed = 0;
+	uint16_t startLevelID = 1;
+	std::string metricsPath; // Writes per frame metrics to this CSV file when set
+	std::string savePath;    // Continues from this save and writes it on exit when set
+};
+
 class Game
 {
 public:
-	Game();
+	Game(const LaunchOptions& options = LaunchOptions());
 	~Game();
 
-	void HandleEvents();
+	void HandleEvents(const InputFrame& input);
 	void Update();
-	void Render() const;
+	void Render(float alpha) const;
 
 	void LoadLevel(uint16_t nexLevelID);
+	void RequestLevel(uint16_t levelID) { m_pendingLevelID = levelID; m_hasPendingLevel = true; }
 
 	bool Running() const { return m_isRunning; }
-	std::bitset<65536 * static_cast<int>(GameObjects::GameObjectsEnum::GAME_OBJECTS_COUNT)>& GetUnlockedObjects() { return m_unlockedGameObjects;  }
+	int GetExitCode() const { return m_exitCode; }
+	WorldState& GetWorldState()       { return m_worldState; }
+	uint16_t GetCurrentLevelID() const { return m_currentLevelID; }
+
+public:
+	// Screens loaded as levels that aren't part of the game itself
+	static constexpr uint16_t GAME_OVER_LEVEL_ID = 999;
+	static constexpr uint16_t MISSING_LEVEL_ID = 404;
 
 private:
 	bool m_isRunning = false;
+	bool m_hasStarted = false;
+	int m_exitCode = 0;
 	bool m_mouseButtonPressed = false;
 	bool m_reloadPressed = false;
+	uint16_t m_heldButtons = 0;
+	bool m_hasPendingShot = false; // Shots wait for the next simulation step
+	Vec2 m_pendingShotPos;
 	SDL_Window* m_window = nullptr;
 	Vec2 m_mousePos;
 	Player m_player;
 
+	// Everything a level loads lives in the level arena and is freed at once
+	// when the next level loads
+	// Geometry rebuilt every step (enemy grid, sight meshes, player sight)
+	// reuses the capacity of buffers in it instead of a frame arena, so steps
+	// stop allocating once each buffer has seen its peak size
+	static constexpr size_t m_LEVEL_ARENA_SIZE = 512 * 1024;
+	static constexpr size_t m_PARSE_ARENA_SIZE = 1024 * 1024;
+	MemoryArena m_levelArena{ m_LEVEL_ARENA_SIZE };
+
 	// Lists of all objects in game
-	std::vector<Primitives2D::Rect>          m_environment;
-	std::vector<GameObjects::AmmoCrate>      m_ammoCrates;
-	std::vector<GameObjects::TransitionBox>  m_transitions;
-	std::vector<GameObjects::Key>            m_keys;
-	std::vector<Enemy>                       m_enemies;
+	std::pmr::vector<Primitives2D::Rect>          m_environment{ &m_levelArena };
+	std::pmr::vector<GameObjects::AmmoCrate>      m_ammoCrates{ &m_levelArena };
+	std::pmr::vector<GameObjects::TransitionBox>  m_transitions{ &m_levelArena };
+	std::pmr::vector<GameObjects::Key>            m_keys{ &m_levelArena };
+	EnemyStore                                    m_enemies{ &m_levelArena };
+	StaticGrid                                    m_levelGrid{ &m_levelArena }; // Every list above but enemies, for player queries
+	EnemyGrid                                     m_enemyGrid{ &m_levelArena }; // Enemy hitboxes, rebuilt every step
+	VisibilityPolygon                             m_playerSight{ &m_levelArena }; // What the player sees, rebuilt once per frame when the player moved
+	FlowField                                     m_flowField{ &m_levelArena };   // Paths to the player for chasing enemies
+	PerceptionScheduler                           m_perceptionScheduler{ &m_levelArena }; // When each enemy looks for the player
+	PerceptionEvents                              m_perceptionEvents{ &m_levelArena };    // Sectors the player sees into and shot noise
 	Text m_text[TEXT_BUFFER_SIZE]; // Use array for text becasuse vector is cooked
 
+	// Level changes requested during Update wait until nothing iterates the level
+	bool m_hasPendingLevel = false;
+	uint16_t m_pendingLevelID = 0;
+
+	// Performance overlay, toggled with F3
+	PerfOverlay m_perfOverlay;
+	FrameTimings m_frameTimings;
+	uint64_t m_frameStartCounter = 0;
+
 	// Tracks which game objects player has unlocked / killed
-	std::bitset<65536 * static_cast<int>(GameObjects::GameObjectsEnum::GAME_OBJECTS_COUNT)> m_unlockedGameObjects; // uint16_t max value is 65535
+	WorldState m_worldState;
+	std::string m_savePath;
 
-	// Delta time vars
-	uint32_t m_currentTime = 0;
-	uint32_t m_lastTime = 0;
-	float m_deltaTime = 0.0f;
+	// Simulation always advances in steps of m_FIXED_DELTA_TIME, rendering
+	// interpolates between the last two steps, times are in nanoseconds
+	static constexpr uint64_t m_FIXED_STEP_NS = 1000000000 / 120;
+	static constexpr float m_FIXED_DELTA_TIME = m_FIXED_STEP_NS / 1000000000.0f;
+	static constexpr uint64_t m_MAX_STEPS_PER_FRAME = 8; // Slow frames slow the game down instead of piling up steps
+	uint64_t m_currentTime = 0;
+	uint64_t m_lastTime = 0;
+	uint64_t m_stepAccumulator = 0;
+	float m_deltaTime = 0.0f; // Real time of the last frame, only used by the overlay
 
+	// Input recording and replay
+	RunMode m_runMode = RunMode::Play;
+	std::string m_recordingPath;
+	InputRecording m_recording;
+	size_t m_replayFrame = 0;
+	uint64_t m_replayStartCounter = 0;
+	uint16_t m_currentLevelID = 0;
+	uint16_t m_lastPlayableLevelID = 1; // Last level that wasn't game over or missing, what saves continue from
+
+	// Allocation check, frames before the warmup is over may still grow vectors
+	static constexpr uint32_t m_ALLOC_CHECK_WARMUP_FRAMES = 600;
+	static constexpr uint32_t m_ALLOC_CHECK_FRAMES = 600;
+	uint32_t m_allocCheckFrame = 0;
+
+private:
+	void Step();
+	void BuildLevelGrid(std::pmr::memory_resource* scratch);
+	void UpdatePlayerSight();
+	void ApplyInput();
+	void EndMetricsFrame();
+	void CheckFrameAllocations(const AllocationTracker::FrameAllocations& allocations);
+	InputFrame PollInput();
+	bool NextReplayInput(InputFrame& input);
+	void FinishFrame(const InputFrame& input);
+	uint64_t ComputeStateChecksum() const;
 };
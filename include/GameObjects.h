@@ -28,26 +28,31 @@ namespace GameObjects
     // Holds all textures used for game objects
     extern CompleteTexture s_textures[static_cast<int>(GameObjectsEnum::GAME_OBJECTS_COUNT)];
     
-    struct AmmoCrate : Primitives2D::Rect
+    // Pickups and doors hold their box instead of inheriting it, so collision
+    // code can take the box alone
+    struct AmmoCrate
     {
+        Primitives2D::Rect bounds;
         uint8_t ammoCount;
-        uint16_t ID;
+        uint32_t ID;
 
-        AmmoCrate(const Vec2& position, uint8_t ammoCount, uint16_t ID);
+        AmmoCrate(const Vec2& position, uint8_t ammoCount, uint32_t ID);
     };
 
-    struct Key : Primitives2D::Rect
+    struct Key
     {
-        uint16_t ID;
+        Primitives2D::Rect bounds;
+        uint32_t ID;
 
-        Key(const Vec2& position, uint16_t ID);
+        Key(const Vec2& position, uint32_t ID);
     };
 
-    struct TransitionBox : Primitives2D::Rect
+    struct TransitionBox
     {
+        Primitives2D::Rect bounds;
         uint16_t nextLevelID;
-        uint16_t keyID;
+        uint32_t keyID;
 
-        TransitionBox(const Vec2& position, float width, float height, uint16_t nextLevelID, uint16_t keyID = 0);
+        TransitionBox(const Vec2& position, float width, float height, uint16_t nextLevelID, uint32_t keyID = 0);
     };
 }
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Vec2.h"
+#include <cstdint>
+#include <vector>
+
+// Held buttons, stored as bits in InputFrame::buttons
+enum InputButton : uint16_t
+{
+    INPUT_UP     = 1 << 0,
+    INPUT_DOWN   = 1 << 1,
+    INPUT_LEFT   = 1 << 2,
+    INPUT_RIGHT  = 1 << 3,
+    INPUT_SPRINT = 1 << 4,
+    INPUT_RELOAD = 1 << 5
+};
+
+// Everything Game::HandleEvents reads during a single frame,
+// the only thing needed to replay a frame exactly
+struct InputFrame
+{
+    uint64_t timestamp = 0; // SDL_GetTicksNS at start of frame, the number of simulation steps is derived from it
+    Vec2 mousePos;
+    Vec2 shootPos;          // Mouse position when shot was fired
+    uint16_t buttons = 0;
+    bool shoot = false;
+    bool quit = false;
+};
+
+class InputRecording
+{
+public:
+    InputRecording()  = default;
+    ~InputRecording() = default;
+
+    bool Save(const char* filepath) const;
+    bool Load(const char* filepath);
+
+    void AddFrame(const InputFrame& input, uint64_t checksum);
+    void Clear();
+
+    size_t GetFrameCount()                      const { return m_frames.size(); }
+    const InputFrame& GetFrame(size_t index)    const { return m_frames[index]; }
+    uint64_t GetChecksum(size_t index)          const { return m_checksums[index]; }
+
+public:
+    uint32_t seed = 0;
+    uint64_t startTime = 0;
+    uint16_t startLevelID = 1;
+
+private:
+    static constexpr uint32_t m_MAGIC = 0x4350524F; // "ORPC"
+    static constexpr uint32_t m_VERSION = 2;
+
+    std::vector<InputFrame> m_frames;
+    std::vector<uint64_t> m_checksums; // Game state after each frame
+};
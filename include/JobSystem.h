@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A range of a ParallelFor call, executed by whichever thread gets to it first
+struct Job
+{
+	void (*function)(const void* data, size_t begin, size_t end) = nullptr;
+	const void* data = nullptr;
+	size_t begin = 0;
+	size_t end = 0;
+	std::atomic<int>* pendingJobs = nullptr;
+};
+
+// Chase-Lev deque, the owning worker pushes and pops at the bottom
+// while other workers steal from the top
+class WorkStealingDeque
+{
+public:
+	WorkStealingDeque()  = default;
+	~WorkStealingDeque() = default;
+
+	bool Push(Job* job);
+	Job* Pop();
+	Job* Steal();
+
+public:
+	static constexpr int64_t CAPACITY = 1024;
+
+private:
+	std::atomic<int64_t> m_top{ 0 };
+	std::atomic<int64_t> m_bottom{ 0 };
+	std::atomic<Job*> m_jobs[CAPACITY];
+};
+
+class JobSystem
+{
+public:
+	static JobSystem& GetInstance();
+	void Init(int workerCount = -1);
+	void Destroy();
+
+	int GetThreadCount() const { return static_cast<int>(m_deques.size()); }
+
+	//-----------------------------------------------------------------------------
+	// Calls function(begin, end) over [0, count) split into batches of at least
+	// minBatchSize, blocks until every batch is done while helping out
+	// Runs inline if the range is too small to split or the job system is
+	// not running
+	//-----------------------------------------------------------------------------
+	template <typename Function>
+	void ParallelFor(size_t count, size_t minBatchSize, const Function& function)
+	{
+		if (count == 0) return;
+
+		if (minBatchSize == 0) minBatchSize = 1;
+		if (count <= minBatchSize || !CanSplit())
+		{
+			function(size_t(0), count);
+			return;
+		}
+
+		auto trampoline = [](const void* data, size_t begin, size_t end)
+		{
+			(*static_cast<const Function*>(data))(begin, end);
+		};
+		Fork(count, minBatchSize, trampoline, &function);
+	}
+
+public:
+	// Upper limit of jobs a single ParallelFor call is split into
+	static constexpr size_t MAX_BATCHES = 256;
+
+private:
+	JobSystem() = default;
+	~JobSystem() { Destroy(); } // Workers must not outlive the condition variable they sleep on
+
+	// Index 0 belongs to the thread that called Init()
+	std::vector<WorkStealingDeque*> m_deques;
+	std::vector<std::thread> m_workers;
+	std::atomic<bool> m_isRunning{ false };
+
+	// Lets idle workers sleep instead of spinning
+	std::atomic<int> m_queuedJobs{ 0 };
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wakeCondition;
+
+private:
+	bool CanSplit() const;
+	void Fork(size_t count, size_t minBatchSize, void (*function)(const void*, size_t, size_t), const void* data);
+	void WorkerLoop(int workerIndex);
+	Job* FindJob(int workerIndex);
+	void Execute(Job* job);
+
+	// Prevent copy and assignment
+	JobSystem(const JobSystem&)            = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+};
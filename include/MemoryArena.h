@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+// Bump allocator, hands out memory from large blocks and frees all of it
+// at once in Reset(), deallocating a single allocation does nothing
+// Used through std::pmr containers, e.g. std::pmr::vector<Rect> rects(&arena)
+class MemoryArena : public std::pmr::memory_resource
+{
+public:
+	explicit MemoryArena(size_t initialCapacity);
+	~MemoryArena() override;
+
+	// Everything allocated from the arena is invalid after this, containers
+	// using it have to be emptied first or never touched again
+	void Reset();
+
+	size_t GetUsedBytes() const        { return m_usedBytes; }
+	size_t GetCapacity() const         { return m_capacity; }
+	size_t GetBlockAllocations() const { return m_blockAllocations; }
+
+private:
+	// Stored at the start of every block
+	struct Block
+	{
+		Block* previous = nullptr;
+		size_t size = 0;
+	};
+
+	Block* m_currentBlock = nullptr;
+	std::byte* m_cursor = nullptr;
+	std::byte* m_end = nullptr;
+
+	size_t m_usedBytes = 0;
+	size_t m_capacity = 0;         // Sum of every block's size
+	size_t m_blockAllocations = 0; // Times the arena itself went to the heap
+
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+	void AddBlock(size_t size);
+	void FreeBlocks();
+
+	// Prevent copy and assignment
+	MemoryArena(const MemoryArena&)            = delete;
+	MemoryArena& operator=(const MemoryArena&) = delete;
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "SPSCQueue.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+// Summed over every thread and reset every frame
+enum class MetricCounter : uint8_t
+{
+	RaysCast = 0,
+	RectTests,
+	SightChecks,
+	TextTexturesCreated,
+	AudioPlays,
+	DrawCalls,
+	LoadLevelMicroseconds,
+	HeapAllocations, // Only counted when built with ENABLE_ALLOC_TRACKER
+	SimulationSteps,
+	FlowFieldUpdates,
+	PerceptionDeferred, // Sight meshes that didn't fit in the frame's budget
+	COUNTER_COUNT
+};
+
+// Set once per frame by the main thread
+enum class MetricGauge : uint8_t
+{
+	FrameMs = 0,
+	EventsMs,
+	PlayerMs,
+	EnemiesMs,
+	RenderMs,
+	Enemies,
+	ShotgunBlasts,
+	AudioVoices,
+	AudioLoad,
+	LevelArenaBytes,
+	GAUGE_COUNT
+};
+
+constexpr int METRIC_COUNTER_COUNT = static_cast<int>(MetricCounter::COUNTER_COUNT);
+constexpr int METRIC_GAUGE_COUNT = static_cast<int>(MetricGauge::GAUGE_COUNT);
+
+// Every metric for a single frame
+struct MetricsFrame
+{
+	uint64_t frame = 0;
+	double time = 0.0; // Seconds since metrics were created
+	uint64_t counters[METRIC_COUNTER_COUNT] = {};
+	float gauges[METRIC_GAUGE_COUNT] = {};
+
+	uint64_t Get(MetricCounter counter) const { return counters[static_cast<int>(counter)]; }
+	float Get(MetricGauge gauge)        const { return gauges[static_cast<int>(gauge)]; }
+};
+
+// Running totals only written by the thread that owns them, so adding to
+// them doesn't need locked instructions or fight over cache lines
+struct alignas(CACHE_LINE_SIZE) ThreadCounters
+{
+	std::atomic<uint64_t> values[METRIC_COUNTER_COUNT] = {};
+};
+
+class Metrics
+{
+public:
+	static Metrics& GetInstance();
+
+	void Add(MetricCounter counter, uint64_t amount = 1);
+	void SetGauge(MetricGauge gauge, float value) { m_gauges[static_cast<int>(gauge)] = value; }
+
+	void EndFrame();
+	const MetricsFrame& GetLastFrame() const { return m_lastFrame; }
+
+	bool StartWriting(const char* filepath);
+	void StopWriting();
+
+	static const char* GetName(MetricCounter counter);
+	static const char* GetName(MetricGauge gauge);
+
+public:
+	static constexpr uint32_t MAX_THREADS = 64;
+	static constexpr size_t WRITE_QUEUE_SIZE = 4096;
+	static constexpr std::chrono::milliseconds FLUSH_INTERVAL{ 1000 };
+
+private:
+	Metrics();
+	~Metrics();
+
+	std::chrono::steady_clock::time_point m_startTime;
+
+	// Registered once per thread and then never removed, threads past
+	// MAX_THREADS share m_overflowCounters
+	ThreadCounters* m_threadCounters[MAX_THREADS] = {};
+	std::atomic<uint32_t> m_threadCount{ 0 };
+	std::mutex m_registerMutex;
+	ThreadCounters m_overflowCounters;
+
+	// Only touched by the main thread
+	float m_gauges[METRIC_GAUGE_COUNT] = {};
+	uint64_t m_previousTotals[METRIC_COUNTER_COUNT] = {};
+	MetricsFrame m_lastFrame;
+
+	// Finished frames are handed to the writer thread, which appends them to
+	// the file every FLUSH_INTERVAL so the main thread never waits on disk
+	SPSCQueue<MetricsFrame, WRITE_QUEUE_SIZE> m_writeQueue;
+	FILE* m_file = nullptr;
+	std::thread m_writerThread;
+	std::atomic<bool> m_isWriting{ false };
+	std::atomic<uint32_t> m_droppedFrames{ 0 };
+	std::mutex m_writerMutex;
+	std::condition_variable m_writerCondition;
+
+private:
+	ThreadCounters* GetThreadCounters();
+	void WriterLoop();
+	void WriteQueuedFrames();
+
+	// Prevent copy and assignment
+	Metrics(const Metrics&)            = delete;
+	Metrics& operator=(const Metrics&) = delete;
+};
+
+// Adds the microseconds between construction and destruction to a counter
+class ScopedMetricTimer
+{
+public:
+	explicit ScopedMetricTimer(MetricCounter counter)
+		: m_counter(counter)
+		, m_start(std::chrono::steady_clock::now())
+	{}
+
+	~ScopedMetricTimer()
+	{
+		auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start);
+		Metrics::GetInstance().Add(m_counter, static_cast<uint64_t>(elapsed.count()));
+	}
+
+private:
+	MetricCounter m_counter;
+	std::chrono::steady_clock::time_point m_start;
+
+private:
+	ScopedMetricTimer(const ScopedMetricTimer&)            = delete;
+	ScopedMetricTimer& operator=(const ScopedMetricTimer&) = delete;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "VisibilityPolygon.h"
+#include <memory_resource>
+
+// What enemy perception reacts to instead of looking every step: which
+// sectors of the level the player can see into and the noise shots make
+// Sight works both ways, so an enemy in a sector the player can't see into
+// can't see the player and never has to check. The sectors are updated
+// every time the player's sight is rebuilt, enemies whose sector comes into
+// sight and enemies that hear a shot check right away
+class PerceptionEvents
+{
+public:
+    explicit PerceptionEvents(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : m_visibleSectors(memory), m_noises(memory) {}
+    ~PerceptionEvents() = default;
+
+    void Build(std::span<const Primitives2D::Rect> walls);
+
+    // Marks every sector playerSight reaches into, call whenever it's rebuilt
+    void SetPlayerSight(const VisibilityPolygon& playerSight);
+
+    // Positions outside the sectors always count as in sight
+    bool IsInPlayerSight(const Vec2& position) const;
+
+    void PublishShot(const Vec2& position);
+    std::span<const Primitives2D::Circle> GetNoises() const { return m_noises; }
+    void ClearNoises() { m_noises.clear(); }
+
+private:
+    static constexpr float m_MIN_SECTOR_SIZE = 256.0f;
+    static constexpr size_t m_MAX_SECTORS = 128 * 128;
+    static constexpr int m_BORDER_SECTORS = 1;
+    static constexpr float m_SHOT_NOISE_RADIUS = 600.0f; // How far away enemies hear a shot
+    static constexpr int m_ANGLE_BUCKETS = 1024;
+
+    std::pmr::vector<uint8_t> m_visibleSectors;
+    std::pmr::vector<Primitives2D::Circle> m_noises; // Published since enemies last updated
+
+    // Furthest the player can see at any angle in each bucket, buckets split
+    // the angles around the player's sight evenly
+    float m_bucketReach[m_ANGLE_BUCKETS] = {};
+
+    Vec2 m_origin;
+    float m_sectorSize = m_MIN_SECTOR_SIZE;
+    int m_columns = 0;
+    int m_rows = 0;
+
+private:
+    static int GetBucket(float angle);
+    void SetReach(int firstBucket, int lastBucket, float reach);
+    bool IsSectorInReach(int column, int row, const Vec2& sightOrigin) const;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Primitives2D.h"
+#include <chrono>
+#include <memory_resource>
+
+struct EnemyBody;
+struct EnemyPerception;
+enum class EnemyStates : uint8_t;
+
+// Decides how often each enemy looks for the player and which enemies get
+// their sight mesh recast this step
+// Sight checks change gameplay, so they run on a fixed number of steps per
+// state and distance, which keeps replays deterministic. Sight meshes are
+// only rendered, so they are recast in priority order until the frame's time
+// budget is spent and the rest wait for the next step
+class PerceptionScheduler
+{
+public:
+    explicit PerceptionScheduler(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : m_entries(memory), m_due(memory) {}
+    ~PerceptionScheduler() = default;
+
+    // Steps between sight checks, chasing enemies check every step
+    static uint16_t GetSightInterval(EnemyStates state, float distanceToPlayer);
+
+    // Makes room for enemyCount enemies so scheduling never allocates
+    void Reserve(size_t enemyCount);
+
+    // Starts the time budget, once per frame so a frame that runs several
+    // steps to catch up shares one budget between them
+    void StartFrameBudget() { m_budgetStart = std::chrono::steady_clock::now(); }
+
+    // Every enemy whose sight mesh is due, the ones that waited the longest
+    // first and then the closest to the player, valid until the next call
+    std::span<const uint32_t> ScheduleMeshes(std::span<const EnemyBody> bodies,
+        std::span<const EnemyPerception> perceptions,
+        const Vec2& playerPos);
+
+    bool HasBudgetLeft() const { return std::chrono::steady_clock::now() - m_budgetStart < m_MESH_BUDGET; }
+
+    // Keeps the sight meshes of enemies that didn't fit in the budget due
+    void Defer(std::span<const uint32_t> indices, std::span<EnemyPerception> perceptions);
+
+private:
+    static constexpr std::chrono::microseconds m_MESH_BUDGET{ 1000 };
+    static constexpr float m_NEAR_DISTANCE = 800.0f; // Roughly half the screen
+
+    struct Entry
+    {
+        uint64_t key; // Steps not waited << 32 | distance to player
+        uint32_t index;
+    };
+
+    std::pmr::vector<Entry> m_entries;
+    std::pmr::vector<uint32_t> m_due;
+    std::chrono::steady_clock::time_point m_budgetStart;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Text.h"
+
+// Everything the overlay shows about a single frame
+struct FrameTimings
+{
+    float frameMs = 0.0f;
+    float eventsMs = 0.0f;
+    float playerMs = 0.0f;
+    float enemiesMs = 0.0f;
+    float renderMs = 0.0f;
+    uint32_t raysCast = 0;
+    uint32_t wallTests = 0;
+    uint32_t drawCalls = 0;
+    uint32_t enemyCount = 0;
+    uint32_t blastCount = 0;
+};
+
+class PerfOverlay
+{
+public:
+    PerfOverlay();
+    ~PerfOverlay() = default;
+
+    void AddFrame(const FrameTimings& timings);
+    void Update(float deltaTime);
+    void Render() const;
+
+    void Toggle()          { m_isVisible = !m_isVisible; m_refreshTimer = 0.0f; }
+    bool IsVisible() const { return m_isVisible; }
+
+private:
+    static constexpr int m_HISTORY_SIZE = 240;
+    static constexpr int m_LINE_COUNT = 6;
+    static constexpr float m_REFRESH_TIME = 0.25f; // Text textures are rebuilt 4 times a second
+    static constexpr float m_GRAPH_WIDTH = 480.0f;
+    static constexpr float m_GRAPH_HEIGHT = 100.0f;
+    static constexpr float m_GRAPH_MAX_MS = 50.0f;
+
+    bool m_isVisible = false;
+    float m_refreshTimer = 0.0f;
+
+    // Frame times are always recorded so percentiles are ready when shown
+    float m_frameTimes[m_HISTORY_SIZE] = {};
+    int m_historyIndex = 0;
+    FrameTimings m_latest;
+
+    Vec2 m_position;
+    Text m_lines[m_LINE_COUNT];
+    SDL_FPoint m_graphPoints[m_HISTORY_SIZE] = {};
+
+private:
+    void RebuildText();
+    void RebuildGraph();
+};
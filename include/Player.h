@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Shotgun.h"
-#include <bitset>
+#include "GameObjects.h"
+#include "StaticGrid.h"
+#include "EnemyGrid.h"
 
 class Game;
 
@@ -19,14 +21,15 @@ public:
     Player();
     ~Player() = default;
 
-    void Update(const std::vector<Primitives2D::Rect>& environment,
-        std::vector<GameObjects::AmmoCrate>& ammoCrates,
-        std::vector<GameObjects::Key>& keys,
-        const std::vector<GameObjects::TransitionBox>& transitionBoxes,
-        const std::vector<Primitives2D::Circle>& enemies,
+    void Update(std::span<const Primitives2D::Rect> environment,
+        std::pmr::vector<GameObjects::AmmoCrate>& ammoCrates,
+        std::pmr::vector<GameObjects::Key>& keys,
+        std::span<const GameObjects::TransitionBox> transitionBoxes,
+        EnemyGrid& enemyGrid,
+        StaticGrid& levelGrid,
         const Vec2& mousePos,
         double deltaTime);
-    void Render() const;
+    void Render(float alpha) const;
 
     Vec2 GetOrigin()               const { return m_position; }
     float GetHitboxRadius()        const { return m_hitboxRadius; }
@@ -36,7 +39,7 @@ public:
     void SetGamePointer(Game* pGame) { m_pGame = pGame; }
 
     void Move(enum Direction dir, double deltaTime);
-    void Shoot(const std::vector<Primitives2D::Rect>& environment, const Vec2& mousePos);
+    bool Shoot(const VisibilityPolygon& playerSight, const Vec2& mousePos);
     void Reload();
 
 public:
@@ -45,8 +48,10 @@ public:
 
 private:
     Vec2 m_position;
+    Vec2 m_previousPosition; // Position before the last update, for render interpolation
     float m_hitboxRadius = 10.0f;
-    std::vector<Primitives2D::LineSegment> m_body;
+    static constexpr int m_MAX_SLIDES = 3;
+    static constexpr float m_COLLISION_SKIN = 0.01f; // Gap left between player and wall after a sweep
     Shotgun m_shotgun;
     bool m_isDead = false;
     Game* m_pGame = nullptr;
@@ -66,11 +71,23 @@ private:
     void UpdateCursor(const Vec2& mousePos);
     float Lerp(float a, float b, float t) const { return a + t * (b - a); }
 
-    void CheckForWallCollisions(const std::vector<Primitives2D::Rect>& environment);
-    void CheckForAmmoPickups(std::vector<GameObjects::AmmoCrate>& ammoCrates);
-    void CheckForKeyPickups(std::vector<GameObjects::Key>& keys);
-	void CheckForTransitionCollisions(const std::vector<GameObjects::TransitionBox>& transitionBoxes);
-    void CheckForEnemyCollisions(const std::vector<Primitives2D::Circle>& enemies);
+    Primitives2D::Rect GetHitboxBounds() const;
 
-    void UnlockGameObject(GameObjects::GameObjectsEnum type, uint16_t ID);
+    void MoveAndSlide(Vec2 displacement,
+        std::span<const Primitives2D::Rect> environment,
+        std::span<const GameObjects::TransitionBox> transitionBoxes,
+        StaticGrid& levelGrid);
+    bool FindFirstWallHit(const Vec2& displacement,
+        std::span<const Primitives2D::Rect> environment,
+        std::span<const GameObjects::TransitionBox> transitionBoxes,
+        StaticGrid& levelGrid,
+        float& timeOfImpact,
+        Vec2& normal) const;
+    void CheckForWallCollisions(std::span<const Primitives2D::Rect> environment, StaticGrid& levelGrid);
+    void CheckForAmmoPickups(std::pmr::vector<GameObjects::AmmoCrate>& ammoCrates, StaticGrid& levelGrid);
+    void CheckForKeyPickups(std::pmr::vector<GameObjects::Key>& keys, StaticGrid& levelGrid);
+	void CheckForTransitionCollisions(std::span<const GameObjects::TransitionBox> transitionBoxes, StaticGrid& levelGrid);
+    void CheckForEnemyCollisions(EnemyGrid& enemyGrid);
+
+    void UnlockGameObject(GameObjects::GameObjectsEnum type, uint32_t ID);
 };
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "Vec2.h"
 
 #include <iostream>
+#include <span>
+#include <type_traits>
 #include <vector>
 
 namespace Primitives2D
@@ -17,7 +19,6 @@ namespace Primitives2D
     {
         Vec2 start;
         Vec2 end;
-        double angle = 0.0f;
 
         LineSegment() = default;
 
@@ -37,6 +38,8 @@ namespace Primitives2D
         float Length() const { return Vec2(end.x - start.x, end.y - start.y).Length(); }
     };
 
+    static_assert(sizeof(LineSegment) == 16, "LineSegment must stay two points");
+
     struct Circle
     {
         Circle() = default;
@@ -49,6 +52,8 @@ namespace Primitives2D
         float radius;
     };
 
+    // Plain axis aligned box, walls are stored and tested in large arrays
+    // so it has no vtable and no other data, render with RenderRect()
     struct Rect
     {
         Vec2 min;
@@ -60,8 +65,6 @@ namespace Primitives2D
             , max(position + Vec2(width, height))
         {}
 
-        virtual void Render(uint8_t r, uint8_t g, uint8_t b, uint8_t a, bool fillRect = true) const;
-
         Vec2 GetTopLeft()     const { return min; }
         Vec2 GetBottomRight() const { return max; }
         Vec2 GetTopRight()    const { return Vec2(max.x, min.y); }
@@ -70,8 +73,12 @@ namespace Primitives2D
         float GetHeight()     const { return max.y - min.y; }
     };
 
+    static_assert(sizeof(Rect) == 16 && std::is_trivially_copyable_v<Rect>, "Rect must stay a plain 16 byte box");
+
+    void RenderRect(const Rect& rect, uint8_t r, uint8_t g, uint8_t b, uint8_t a, bool fillRect = true);
+
     // Collision detection functions
-    std::vector<LineSegment> CreateUniformShape(const Vec2& pos, float radius, int sides);
+    void CreateUniformShape(const Vec2& pos, float radius, std::span<LineSegment> segments);
 
     Vec2 ClosestPointOnLine(const Vec2& point, const LineSegment& line);
     Intersect CheckLineCircleCollision(const LineSegment& line, const Circle& circle);
@@ -81,4 +88,7 @@ namespace Primitives2D
     bool CheckCircleCircleCollision(const Circle& circle1, const Circle& circle2);
     bool CheckRectRectCollision(const Rect& rect1, const Rect& rect2);
     bool CheckRectCircleCollision(const Rect& rect, const Circle& circle);
+
+    // Continuous collision, finds when a moving circle first touches a rect
+    bool SweepCircleRect(const Circle& circle, const Vec2& displacement, const Rect& rect, float& timeOfImpact, Vec2& normal);
 }
\ No newline at end of file
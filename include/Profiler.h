@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+// Zones are only recorded when built with ENABLE_PROFILER, otherwise the
+// macros compile to nothing
+#if defined(ENABLE_PROFILER)
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#endif
+
+struct ZoneEvent
+{
+	const char* name = nullptr; // Has to outlive the profiler, use string literals
+	uint64_t start = 0;         // Nanoseconds since profiler started
+	uint64_t end = 0;
+};
+
+// Ring buffer of finished zones, only written by the thread that owns it
+struct ThreadZoneBuffer
+{
+	static constexpr size_t CAPACITY = 1 << 16;
+
+	std::atomic<uint64_t> head{ 0 };
+	uint32_t threadIndex = 0;
+	ZoneEvent events[CAPACITY];
+};
+
+class Profiler
+{
+public:
+	static Profiler& GetInstance();
+
+	void RecordZone(const char* name, uint64_t start, uint64_t end);
+	bool WriteChromeTrace(const char* filepath) const;
+
+	uint64_t Now() const;
+
+	// Innermost zone open on the calling thread, nullptr outside of zones
+	static const char* GetCurrentZone();
+	static void SetCurrentZone(const char* name);
+
+public:
+	static constexpr uint32_t MAX_THREADS = 64;
+
+private:
+	Profiler();
+	~Profiler();
+
+	std::chrono::steady_clock::time_point m_startTime;
+
+	// Buffers are registered once per thread and then never removed
+	ThreadZoneBuffer* m_buffers[MAX_THREADS] = {};
+	std::atomic<uint32_t> m_bufferCount{ 0 };
+	std::mutex m_registerMutex;
+
+private:
+	ThreadZoneBuffer* GetThreadBuffer();
+
+	// Prevent copy and assignment
+	Profiler(const Profiler&)            = delete;
+	Profiler& operator=(const Profiler&) = delete;
+};
+
+// Records the time between construction and destruction as a zone
+class ProfileZone
+{
+public:
+	explicit ProfileZone(const char* name)
+		: m_name(name)
+		, m_parentZone(Profiler::GetCurrentZone())
+		, m_start(Profiler::GetInstance().Now())
+	{
+		Profiler::SetCurrentZone(name);
+	}
+
+	~ProfileZone()
+	{
+		Profiler::GetInstance().RecordZone(m_name, m_start, Profiler::GetInstance().Now());
+		Profiler::SetCurrentZone(m_parentZone);
+	}
+
+private:
+	const char* m_name;
+	const char* m_parentZone;
+	uint64_t m_start;
+
+private:
+	ProfileZone(const ProfileZone&)            = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+// PCG32 generator, the same seed gives the same sequence on every platform
+// unlike rand(), which is what makes recordings replayable
+class RandomStream
+{
+public:
+    RandomStream() { Seed(0, 0); }
+    ~RandomStream() = default;
+
+    void Seed(uint64_t seed, uint64_t streamID);
+
+    uint32_t NextUint();
+    float NextFloat(); // [0, 1)
+
+private:
+    uint64_t m_state = 0;
+    uint64_t m_increment = 1;
+};
+
+// Every system that needs randomness gets its own stream, so adding random
+// calls to one system doesn't change the numbers another system gets
+namespace Random
+{
+    enum class Stream
+    {
+        ShotgunSpread = 0,
+        STREAM_COUNT = 1
+    };
+
+    void SeedAll(uint32_t seed);
+    RandomStream& Get(Stream stream);
+}
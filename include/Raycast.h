@@ -1,33 +1,65 @@
 #pragma once
 
-#include "GameObjects.h"
+#include "Primitives2D.h"
+#include <memory_resource>
+#include <type_traits>
 
+// Every ray in a cast starts at the same origin, so only the end point and
+// the angle used for sorting are stored per ray, in separate arrays
 class Raycast
 {
 public:
     Raycast()  = default;
-    ~Raycast() = default;
+    explicit Raycast(std::pmr::memory_resource* memory)
+        : m_rayEnds(memory), m_rayAngles(memory), m_sortKeys(memory), m_sortedEnds(memory), m_visibleVertices(memory) {}
 
     void Render(bool drawHits = false, uint8_t r = 0, uint8_t g = 0, uint8_t b = 0, uint8_t a = 255) const;
-    void RenderGeometry() const;
+    void RenderGeometry(const Vec2& offset = Vec2::Zero()) const;
     void SortRays();
 
-    const std::vector<Primitives2D::LineSegment>& GetRays() const { return m_rays; }
+    size_t GetRayCount()                   const { return m_rayEnds.size(); }
+    Vec2 GetOrigin()                       const { return m_origin; }
+    std::span<const Vec2> GetRayEnds()     const { return m_rayEnds; }
+    std::span<const float> GetRayAngles()  const { return m_rayAngles; }
 
     void CastRaysAtVertices(const Vec2& origin,
-        const std::vector<Primitives2D::Rect>& environment,
+        std::span<const Primitives2D::Rect> environment,
         const Vec2& fovCenter = Vec2::Zero(),
         float fov = 0);
-    bool CastRayToPos(const Vec2& origin, const Vec2& pos, const std::vector<Primitives2D::Rect>& environment, bool infiniteLength = false);
+    bool CastRayToPos(const Vec2& origin, const Vec2& pos, std::span<const Primitives2D::Rect> environment, bool infiniteLength = false);
+    static bool TraceRayToPos(const Vec2& origin, const Vec2& pos, std::span<const Primitives2D::Rect> environment, bool infiniteLength, Primitives2D::LineSegment& ray);
     void ResetRays();
 
 private:
     static constexpr float m_RAY_LENGTH = 100000.0f;
 
-    std::vector<Primitives2D::LineSegment> m_rays;
-    std::vector<Vec2> m_rayHits;
+    // Roughly how many rect tests a job should do before splitting a cast
+    // across threads pays for itself
+    static constexpr size_t m_MIN_RECT_TESTS_PER_JOB = 8192;
+
+    struct SortKey
+    {
+        float angle;
+        uint32_t index;
+    };
+
+    Vec2 m_origin;
+
+    // Moves keep the memory resource, copies always use the default heap
+    // Cleared, not freed, between casts so capacity is reused
+    std::pmr::vector<Vec2> m_rayEnds;
+    std::pmr::vector<float> m_rayAngles;
+    std::pmr::vector<SortKey> m_sortKeys;
+    std::pmr::vector<Vec2> m_sortedEnds;
+    std::pmr::vector<Vec2> m_visibleVertices;
 
 private:
-    bool FindClosestIntersection(const Vec2& origin, const Vec2& rayEnd, const std::vector<Primitives2D::Rect>& environment, const Primitives2D::LineSegment& referenceLine);
-    void SetRayAngle(Primitives2D::LineSegment& ray, const Primitives2D::LineSegment& referenceLine);
-};
\ No newline at end of file
+    bool FindClosestIntersection(const Vec2& origin, const Vec2& rayEnd, std::span<const Primitives2D::Rect> environment, const Vec2& referenceDirection);
+    void BeginCast(const Vec2& origin);
+    static Vec2 TraceRay(const Vec2& origin, const Vec2& rayEnd, std::span<const Primitives2D::Rect> environment, bool& hitWall);
+    static float GetRayAngle(const Vec2& origin, const Vec2& rayEnd, const Vec2& referenceDirection);
+};
+
+// Stores move raycasts around when enemies are added and removed, a copy
+// would move the buffers out of the memory resource they were given
+static_assert(std::is_nothrow_move_constructible_v<Raycast>, "Raycast must stay movable without copying its buffers");
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// Wait-free fixed size ring buffer for exactly one producer thread and
+// one consumer thread, Capacity has to be a power of two
+template <typename T, size_t Capacity>
+class SPSCQueue
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SPSCQueue capacity has to be a power of two");
+
+public:
+	SPSCQueue()  = default;
+	~SPSCQueue() = default;
+
+	//-----------------------------------------------------------------------------
+	// Producer only, returns false if queue is full
+	//-----------------------------------------------------------------------------
+	bool Push(const T& item)
+	{
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_head.load(std::memory_order_acquire) == Capacity) return false;
+
+		m_items[tail & (Capacity - 1)] = item;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	//-----------------------------------------------------------------------------
+	// Consumer only, returns false if queue is empty
+	//-----------------------------------------------------------------------------
+	bool Pop(T& item)
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire)) return false;
+
+		item = m_items[head & (Capacity - 1)];
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool IsEmpty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire); }
+
+private:
+	// Head and tail on separate cache lines so producer and consumer don't fight over them
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head{ 0 };
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail{ 0 };
+	alignas(CACHE_LINE_SIZE) T m_items[Capacity];
+
+private:
+	// Prevent copy and assignment
+	SPSCQueue(const SPSCQueue&)            = delete;
+	SPSCQueue& operator=(const SPSCQueue&) = delete;
+};
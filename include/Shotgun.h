@@ -1,24 +1,9 @@
 #pragma once
 
 #include "Raycast.h"
+#include "VisibilityPolygon.h"
 #include "Text.h"
 
-struct ShotgunBlast
-{
-    Raycast rays;
-    Raycast collisionRays;
-    bool collisionChecked;
-    float alpha;
-
-    ShotgunBlast(const Raycast& rays, float alpha)
-        : rays(rays)
-        , collisionRays(rays)
-        , collisionChecked(false)
-        , alpha(alpha)
-    {
-    }
-};
-
 class Shotgun
 {
 public:
@@ -32,24 +17,48 @@ public:
     int GetMaxReserveAmmo()                                const { return m_maxReserveAmmo; }
     int GetCurrentMagAmmo()                                const { return m_currentMagAmmo; }
     int GetMaxMagAmmo()                                    const { return m_maxMagAmmo; }
-    const std::vector<ShotgunBlast>& GetShotgunBlastsRef() const { return m_blasts; }
+
+    // Blasts go from oldest (0) to newest (GetBlastCount() - 1)
+    int GetBlastCount()                                              const { return m_blastCount; }
+    float GetBlastAlpha(int blast)                                   const { return m_blastAlpha[GetBlastSlot(blast)]; }
+    bool BlastCollides(int blast)                                    const { return m_blastCollides[GetBlastSlot(blast)]; }
+    std::span<const Primitives2D::LineSegment> GetBlastPellets(int blast) const;
 
     void SetCurrentReserveAmmo(uint8_t value) { m_currentReserveAmmo = value; }
     void SetCurrentMagAmmo(uint8_t value)     { m_currentMagAmmo = value; }
 
     void AddReserveAmmo(int amount) { m_currentReserveAmmo = m_currentReserveAmmo + amount > m_maxReserveAmmo ? m_maxReserveAmmo : m_currentReserveAmmo + amount; }
-    void ClearTraces() { m_blasts.clear(); }
+    void ClearTraces() { m_blastCount = 0; }
 
-    void Shoot(const std::vector<Primitives2D::Rect>& environment, const Vec2& playerPos, const Vec2& position, float radius);
+    bool Shoot(const VisibilityPolygon& playerSight, const Vec2& position, float radius);
     void Reload();
 
 private:
-    std::vector<ShotgunBlast> m_blasts;
+    static constexpr int m_PELLETS_PER_BLAST = 5;
+
+    // Blasts fade out in the order they were shot, so they are kept in a ring
+    // and expiring one just moves m_firstBlast forward, shooting while the
+    // ring is full overwrites the oldest blast
+    // Pellets of blast slot i are m_pellets[i * m_PELLETS_PER_BLAST] onwards
+    static constexpr int m_MAX_BLASTS = 32;
+    Primitives2D::LineSegment m_pellets[m_MAX_BLASTS * m_PELLETS_PER_BLAST];
+    float m_blastAlpha[m_MAX_BLASTS] = {};
+    bool m_blastCollides[m_MAX_BLASTS] = {};          // Enemies are only hit on the frame a blast is shot
+    bool m_blastCollisionChecked[m_MAX_BLASTS] = {};
+    int m_firstBlast = 0;
+    int m_blastCount = 0;
+
     Text m_ammoText;
 
-    const int m_bulletAmount = 5;
+    // Ammo text is only recreated when the ammo count has changed
+    int m_shownMagAmmo = -1;
+    int m_shownReserveAmmo = -1;
+
     int m_maxMagAmmo = 8;
     int m_maxReserveAmmo = 80;
     int m_currentMagAmmo = 0;
     int m_currentReserveAmmo = 0;
+
+private:
+    int GetBlastSlot(int blast) const { return (m_firstBlast + blast) % m_MAX_BLASTS; }
 };
\ No newline at end of file
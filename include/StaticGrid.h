@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Primitives2D.h"
+#include <array>
+#include <memory_resource>
+
+// Every kind of level object the grid keeps, each layer is queried on its own
+enum class GridLayer : uint8_t
+{
+    Walls = 0,
+    Transitions,
+    AmmoCrates,
+    Keys,
+    LAYER_COUNT
+};
+
+// Uniform grid over a level's static objects, built once by LoadLevel
+// Objects are stored by their index in the level's lists, an object is in
+// every cell its bounds touch, so a query only visits cells near the area
+class StaticGrid
+{
+public:
+    static constexpr int LAYER_COUNT = static_cast<int>(GridLayer::LAYER_COUNT);
+
+    explicit StaticGrid(std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+    ~StaticGrid() = default;
+
+    void Build(const std::array<std::span<const Primitives2D::Rect>, LAYER_COUNT>& layers);
+
+    // Indices of every object in layer whose bounds overlap area, each only
+    // once, valid until the next query
+    std::span<const uint32_t> Query(GridLayer layer, const Primitives2D::Rect& area);
+
+    // Where a ray from origin to rayEnd first hits an object in layer, only
+    // visits the cells along the ray up to the hit, false if nothing is hit
+    bool CastRay(GridLayer layer, const Vec2& origin, const Vec2& rayEnd, Vec2& hit);
+
+    // Mirrors SwapAndPop on the layer's list, the last object takes index's place
+    void SwapAndPop(GridLayer layer, uint32_t index);
+
+private:
+    static constexpr float m_MIN_CELL_SIZE = 64.0f;
+    static constexpr size_t m_MAX_CELLS = 256 * 256;
+
+    struct Layer
+    {
+        explicit Layer(std::pmr::memory_resource* memory)
+            : bounds(memory), cellStart(memory), cellCount(memory), items(memory), queryStamps(memory) {}
+
+        std::pmr::vector<Primitives2D::Rect> bounds; // Copy of every object's bounds, by index
+        std::pmr::vector<uint32_t> cellStart;        // Where each cell's objects start in items
+        std::pmr::vector<uint32_t> cellCount;        // Objects currently in each cell
+        std::pmr::vector<uint32_t> items;
+        std::pmr::vector<uint32_t> queryStamps;      // Last query that visited each object
+    };
+
+    std::array<Layer, LAYER_COUNT> m_layers;
+    std::pmr::vector<uint32_t> m_results;
+    uint32_t m_queryStamp = 0;
+
+    Vec2 m_origin;
+    float m_cellSize = m_MIN_CELL_SIZE;
+    int m_columns = 0;
+    int m_rows = 0;
+
+private:
+    void GetCellRange(const Primitives2D::Rect& area, int& minColumn, int& minRow, int& maxColumn, int& maxRow) const;
+    void RemoveFromCells(Layer& layer, uint32_t index);
+    void RenameInCells(Layer& layer, uint32_t from, uint32_t to);
+};
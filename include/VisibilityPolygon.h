@@ -0,0 +1,110 @@
+#pragma once
+
+#include "StaticGrid.h"
+#include <memory_resource>
+#include <set>
+
+// Everything visible from one point, stored as the points where the
+// closest wall changes, sorted by angle around the origin
+// The outline of all walls is collected once per level by SetWalls(),
+// Build() sweeps a ray around the origin over the outline edges facing it
+// and keeps the edges the ray crosses ordered by distance, O(n log n)
+// Two neighbouring points always lie on the same wall, so whether a point
+// is visible, or where a ray stops, only needs a binary search by angle
+class VisibilityPolygon
+{
+public:
+    explicit VisibilityPolygon(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : m_edges(memory), m_angles(memory), m_points(memory), m_segments(memory), m_events(memory)
+        , m_active(memory), m_activeNodes(memory), m_spareNodes(memory) {}
+
+    void SetWalls(std::span<const Primitives2D::Rect> walls, StaticGrid& levelGrid);
+    void Build(const Vec2& origin);
+
+    bool IsEmpty()         const { return m_points.empty(); }
+    size_t GetPointCount() const { return m_points.size(); }
+    Vec2 GetOrigin()       const { return m_origin; }
+
+    // Outline of everything visible, sorted by angle around origin
+    std::span<const Vec2> GetPoints()  const { return m_points; }
+    std::span<const float> GetAngles() const { return m_angles; }
+
+    // Checks if nothing blocks the line from origin to point
+    bool IsVisible(const Vec2& point) const;
+
+    // Where a ray from origin towards target hits a wall, rays that hit
+    // nothing stop m_RAY_LENGTH away
+    Vec2 GetHitPos(const Vec2& target) const;
+
+private:
+    static constexpr float m_RAY_LENGTH = 100000.0f;
+    static constexpr int m_OPEN_RAYS = 8; // Evenly spread rays so open areas still have a shape
+    static constexpr uint32_t m_NO_SEGMENT = UINT32_MAX;
+    static constexpr float m_SWEEP_HALF_TURN = 2.0f; // Sweep angle of PI
+
+    // Piece of the walls' outline, walls are on the left going from start to end
+    struct Edge
+    {
+        Vec2 start;
+        Vec2 end;
+    };
+
+    // Edge facing the origin, relative to the origin and ordered by angle,
+    // angles are sweep angles, see GetSweepAngle()
+    struct SweepSegment
+    {
+        Vec2 start;
+        Vec2 end;
+        float startAngle;
+        float endAngle;
+        uint32_t index;
+    };
+
+    // A segment starting or ending, one integer so sorting them is cheap,
+    // sorts by angle and then ends before starts
+    struct SweepEvent
+    {
+        uint64_t key; // Sweep angle bits << 32 | is start << 31 | segment
+
+        uint32_t GetSegment() const { return static_cast<uint32_t>(key & 0x7FFFFFFF); }
+        bool IsEnd()          const { return (key & 0x80000000) == 0; }
+    };
+
+    // Segments never cross, so which of two is closer is the same for every
+    // ray both are crossed by, it's checked in the middle of their overlap
+    struct IsCloser
+    {
+        bool operator()(const SweepSegment& a, const SweepSegment& b) const;
+    };
+
+    using ActiveSegments = std::pmr::set<SweepSegment, IsCloser>;
+
+    // Wrapped, a pmr vector would otherwise try to pass its memory to the
+    // node handle as if it was an allocator aware type
+    struct SpareNode
+    {
+        ActiveSegments::node_type node;
+    };
+
+    Vec2 m_origin;
+    std::pmr::vector<Edge> m_edges;   // Outline of all walls, edges inside other walls are left out
+    std::pmr::vector<float> m_angles; // Sorted, searched on their own
+    std::pmr::vector<Vec2> m_points;  // Same order as m_angles
+
+    // Sweep state, kept so building doesn't allocate once it has seen its
+    // biggest sweep, removed set nodes are kept and inserted again
+    std::pmr::vector<SweepSegment> m_segments;
+    std::pmr::vector<SweepEvent> m_events;
+    ActiveSegments m_active;
+    std::pmr::vector<ActiveSegments::iterator> m_activeNodes; // Where each segment is in m_active
+    std::pmr::vector<SpareNode> m_spareNodes;
+
+private:
+    void AddSegment(const Vec2& start, const Vec2& end, float startAngle, float endAngle);
+    void AddPoint(float angle, const Vec2& relativePosition);
+    float GetEventAngle(const SweepEvent& event) const;
+    Vec2 GetSweepHit(uint32_t segment, float sweepAngle, const Vec2& direction) const;
+    static float GetSweepAngle(const Vec2& direction);
+    static double GetDistance(const SweepSegment& segment, double directionX, double directionY);
+    void GetEdge(const Vec2& direction, size_t& first, size_t& second) const;
+};
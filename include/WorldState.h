@@ -0,0 +1,44 @@
+#pragma once
+
+#include "GameObjects.h"
+#include <cstdint>
+#include <vector>
+
+// Every game object the player has picked up or killed, keyed by level,
+// type and ID, memory only grows with what has actually been collected
+// Keys open doors on other levels, so keys ignore the level they were found on
+class WorldState
+{
+public:
+    WorldState()  = default;
+    ~WorldState() = default;
+
+    bool Contains(uint16_t levelID, GameObjects::GameObjectsEnum type, uint32_t ID) const;
+    void Insert(uint16_t levelID, GameObjects::GameObjectsEnum type, uint32_t ID);
+    void Clear();
+
+    size_t Size() const { return m_count; }
+
+    // Saved as a sorted array of keys after a small header, so the file
+    // could also be mapped and binary searched as is
+    bool Save(const char* filepath, uint16_t currentLevelID) const;
+    bool Load(const char* filepath, uint16_t& currentLevelID);
+
+private:
+    static constexpr uint32_t m_MAGIC = 0x54535057; // "WPST"
+    static constexpr uint32_t m_VERSION = 1;
+    static constexpr uint64_t m_EMPTY = UINT64_MAX;
+    static constexpr size_t m_MIN_CAPACITY = 64;
+
+    // Open addressing with linear probing, capacity is a power of two
+    // and kept at least twice the count
+    std::vector<uint64_t> m_slots;
+    size_t m_count = 0;
+
+private:
+    static uint64_t MakeKey(uint16_t levelID, GameObjects::GameObjectsEnum type, uint32_t ID);
+    static size_t Hash(uint64_t key);
+
+    void InsertKey(uint64_t key);
+    void Grow();
+};
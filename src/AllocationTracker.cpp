@@ -0,0 +1,214 @@
+#include "AllocationTracker.h"
+#include "Profiler.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h> // _aligned_malloc
+#endif
+
+#if defined(ENABLE_ALLOC_TRACKER)
+
+namespace
+{
+    constexpr size_t MAX_ZONES = 128; // Power of two
+
+    // Zones are looked up by name pointer, profiler zone names are string
+    // literals so the same zone always has the same pointer
+    struct ZoneSlot
+    {
+        std::atomic<const char*> zone{ nullptr };
+        std::atomic<uint64_t> count{ 0 };
+        std::atomic<uint64_t> bytes{ 0 };
+    };
+
+    ZoneSlot s_zones[MAX_ZONES];
+    std::atomic<uint64_t> s_count{ 0 };
+    std::atomic<uint64_t> s_bytes{ 0 };
+    std::atomic<uint64_t> s_lostZones{ 0 };
+
+    // Copy of s_zones from the last EndFrame(), main thread only
+    AllocationTracker::ZoneAllocations s_frameZones[MAX_ZONES];
+    size_t s_frameZoneCount = 0;
+
+    const char* const NO_ZONE = "(no zone)";
+    const char* const TOO_MANY_ZONES = "(zone table full)";
+}
+
+namespace AllocationTracker
+{
+    //-----------------------------------------------------------------------------
+    // Returns true since the tracker was compiled in
+    //-----------------------------------------------------------------------------
+    bool IsEnabled()
+    {
+        return true;
+    }
+
+
+    //-----------------------------------------------------------------------------
+    // Counts an allocation, can't allocate itself since it's called by operator new
+    //-----------------------------------------------------------------------------
+    void RecordAllocation(size_t size)
+    {
+        s_count.fetch_add(1, std::memory_order_relaxed);
+        s_bytes.fetch_add(size, std::memory_order_relaxed);
+
+        const char* zone = Profiler::GetCurrentZone();
+        if (zone == nullptr) zone = NO_ZONE;
+
+        // Linear probing, claims an empty slot the first time a zone allocates
+        size_t index = (reinterpret_cast<uintptr_t>(zone) >> 3) & (MAX_ZONES - 1);
+        for (size_t probe = 0; probe < MAX_ZONES; probe++)
+        {
+            ZoneSlot& slot = s_zones[(index + probe) & (MAX_ZONES - 1)];
+
+            const char* current = slot.zone.load(std::memory_order_acquire);
+            if (current == nullptr && slot.zone.compare_exchange_strong(current, zone, std::memory_order_acq_rel))
+                current = zone;
+
+            if (current != zone) continue;
+
+            slot.count.fetch_add(1, std::memory_order_relaxed);
+            slot.bytes.fetch_add(size, std::memory_order_relaxed);
+            return;
+        }
+
+        s_lostZones.fetch_add(1, std::memory_order_relaxed);
+    }
+
+
+    //-----------------------------------------------------------------------------
+    // Returns and resets allocations made since last call, also saves and
+    // resets allocations per zone
+    //-----------------------------------------------------------------------------
+    FrameAllocations EndFrame()
+    {
+        FrameAllocations frame;
+        frame.count = s_count.exchange(0, std::memory_order_relaxed);
+        frame.bytes = s_bytes.exchange(0, std::memory_order_relaxed);
+
+        s_frameZoneCount = 0;
+        for (ZoneSlot& slot : s_zones)
+        {
+            uint64_t count = slot.count.exchange(0, std::memory_order_relaxed);
+            uint64_t bytes = slot.bytes.exchange(0, std::memory_order_relaxed);
+            if (count == 0) continue;
+
+            s_frameZones[s_frameZoneCount++] = { slot.zone.load(std::memory_order_acquire), count, bytes };
+        }
+
+        uint64_t lost = s_lostZones.exchange(0, std::memory_order_relaxed);
+        if (lost > 0 && s_frameZoneCount < MAX_ZONES)
+            s_frameZones[s_frameZoneCount++] = { TOO_MANY_ZONES, lost, 0 };
+
+        return frame;
+    }
+
+
+    //-----------------------------------------------------------------------------
+    // Copies allocations per zone of the frame ended by the last EndFrame()
+    //-----------------------------------------------------------------------------
+    size_t GetFrameZones(ZoneAllocations* zones, size_t maxZones)
+    {
+        size_t count = s_frameZoneCount < maxZones ? s_frameZoneCount : maxZones;
+        for (size_t i = 0; i < count; i++)
+            zones[i] = s_frameZones[i];
+
+        return count;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Replaced global allocation functions, every form of operator new ends up
+// in one of these two
+//-----------------------------------------------------------------------------
+static void* TrackedAllocate(size_t size)
+{
+    AllocationTracker::RecordAllocation(size);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+static void* TrackedAllocateAligned(size_t size, std::align_val_t alignment)
+{
+    AllocationTracker::RecordAllocation(size);
+
+    size_t align = static_cast<size_t>(alignment);
+#if defined(_WIN32)
+    return _aligned_malloc(size == 0 ? 1 : size, align);
+#else
+    // aligned_alloc wants size to be a multiple of alignment
+    size_t roundedSize = (size + align - 1) / align * align;
+    return std::aligned_alloc(align, roundedSize == 0 ? align : roundedSize);
+#endif
+}
+
+static void FreeAligned(void* ptr)
+{
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+void* operator new(size_t size)
+{
+    void* ptr = TrackedAllocate(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    void* ptr = TrackedAllocate(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    void* ptr = TrackedAllocateAligned(size, alignment);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    void* ptr = TrackedAllocateAligned(size, alignment);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept                                  { return TrackedAllocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept                                { return TrackedAllocate(size); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept      { return TrackedAllocateAligned(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept    { return TrackedAllocateAligned(size, alignment); }
+
+void operator delete(void* ptr) noexcept                                                          { std::free(ptr); }
+void operator delete[](void* ptr) noexcept                                                        { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept                                                  { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept                                                { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept                                        { FreeAligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept                                      { FreeAligned(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept                                { FreeAligned(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept                              { FreeAligned(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept                                   { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept                                 { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept                 { FreeAligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept               { FreeAligned(ptr); }
+
+#else
+
+// Tracker is compiled out, everything reports zero allocations
+namespace AllocationTracker
+{
+    bool IsEnabled()                                       { return false; }
+    FrameAllocations EndFrame()                            { return FrameAllocations(); }
+    size_t GetFrameZones(ZoneAllocations*, size_t)         { return 0; }
+    void RecordAllocation(size_t)                          {}
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "AudioManager.h"
+#include "Metrics.h"
 
 //-----------------------------------------------------------------------------
 // Returns reference to singelton instance
@@ -11,8 +12,7 @@ AudioManager& AudioManager::GetInstance()
 
 
 //-----------------------------------------------------------------------------
-// Initalizes SDL_Mixer and sets up spec and audio device for 
-// SDL_mixer to use
+// Initalizes SDL audio and opens the audio device used by the mixer
 //-----------------------------------------------------------------------------
 bool AudioManager::Init()
 {
@@ -23,29 +23,20 @@ bool AudioManager::Init()
         return false;
     }
 
-    // Opens an audio device for SDL_mixer to use
-    if (!Mix_OpenAudio(0, NULL))
-    {
-        std::cerr << "SDL_mixer could not open an audio device! Error: " << SDL_GetError() << '\n';
-        return false;
-    }
-
-    return true;
+    // Opens an audio device that mixer will mix all voices into
+    return m_mixer.Init();
 }
 
 
 //-----------------------------------------------------------------------------
-// Cleans up all resources used by AudioManager and exits SDL_Mixer
+// Cleans up all resources used by AudioManager and closes audio device
 //-----------------------------------------------------------------------------
 void AudioManager::Destroy()
 {
-    // Destroys all Mix_Chunks
-    UnloadAllAudio();
-
-    // Closes SDL_mixer open audio device
-    Mix_CloseAudio();
+    // Closes audio device before freeing samples it might be reading
+    m_mixer.Destroy();
 
-    Mix_Quit();
+    UnloadAllAudio();
 
     // Since only this class uses the SDL audio-subsystem
     SDL_QuitSubSystem(SDL_INIT_AUDIO);
@@ -53,92 +44,85 @@ void AudioManager::Destroy()
 
 
 //-----------------------------------------------------------------------------
-// Creates a singel Mix_Chunk, specified by an AudioEnum,
-// and adds it to m_audioChunks 
+// Loads a singel AudioSample, specified by an AudioEnum,
+// and places it in m_samples
 //-----------------------------------------------------------------------------
 bool AudioManager::LoadAudio(AudioEnum audioID)
 {
     // Reload WAV file if audio is already loaded
-    Mix_Chunk*& audioChunk = m_audioChunks[static_cast<int>(audioID)];
-    if (audioChunk != nullptr)
+    AudioSample& sample = m_samples[static_cast<int>(audioID)];
+    if (sample.IsLoaded())
     {
         std::cout << "WAV file is already loaded, reloading." << '\n';
-        Mix_FreeChunk(audioChunk);
+        UnloadAudio(audioID);
     }
     
     // Gets filepath to audio file that is going to be loaded
     std::string filepath = "./assets/audio/" + GetAudioFilepath(audioID);
 
-    // Attempts to load the WAV file
-    audioChunk = Mix_LoadWAV(filepath.c_str());
-    if (audioChunk == nullptr)
-    {
-        std::cerr << "Mix_LoadWAV failed! Error: " << SDL_GetError() << '\n';
-        return false;
-    }
-    
-    return true;
+    // Attempts to load and convert the WAV file
+    return m_mixer.LoadSample(filepath.c_str(), sample);
 }
 
 
 //-----------------------------------------------------------------------------
-// Creates Mix_Chunks for all audio files connected to AudioEnum
+// Loads AudioSamples for all audio files connected to AudioEnum
 //-----------------------------------------------------------------------------
 bool AudioManager::LoadAllAudio()
 {
-    // Loads audio for every entry in AudioEnum
+    // Loads audio for every entry in AudioEnum, keeps loading the rest
+    // if one fails so a missing file doesn't mute the whole game
+    bool result = true;
     int enumCount = static_cast<int>(AudioEnum::AUDIO_ENUM_COUNT);
     for (int i = 0; i < enumCount; i++)
     {
-        // Stops loading audio if something fails
         if (!LoadAudio(static_cast<AudioEnum>(i)))
-            return false;
+            result = false;
     }
 
-    return true;
+    return result;
 }
 
 
 //-----------------------------------------------------------------------------
-// Creates a new audio channel and plays a Mix_Chunk, 
-// specified by an AudioEnum, on it
+// Posts an AudioSample, specified by an AudioEnum, to the audio thread
+// Never blocks, so it is safe to call from gameplay code on any thread
+// Returns an ID for later handling, or 0 if it could not be queued
 //-----------------------------------------------------------------------------
-int AudioManager::Play(AudioEnum audioID)
+uint32_t AudioManager::Play(AudioEnum audioID)
 {
-    Mix_Chunk*& audioChunk = m_audioChunks[static_cast<int>(audioID)];
-    int shouldLoop = audioID == AudioEnum::Music ? -1 : 0; // Only thing that should loop is the music
-
-    // Plays audio chunk on a new channel
-    int channel = Mix_PlayChannel(-1, audioChunk, shouldLoop);
-    if (channel == -1)
+    // Reports audio the audio thread had to drop since last time
+    uint32_t dropped = m_mixer.GetDroppedCount();
+    if (m_reportedDrops.exchange(dropped, std::memory_order_relaxed) != dropped)
     {
-        std::cerr << "Could not create audio channel because there are no avaiable audio channels!" << '\n';
-        return 69;
+        std::cerr << "Audio has been dropped, " << dropped << " sounds dropped in total!" << '\n';
     }
 
-    // Groups channel for easier access later
-    Mix_GroupChannel(channel, static_cast<int>(audioID));
+    Metrics::GetInstance().Add(MetricCounter::AudioPlays);
+
+    const AudioSample& sample = m_samples[static_cast<int>(audioID)];
+    bool shouldLoop = audioID == AudioEnum::Music; // Only thing that should loop is the music
 
-    // Returns channel for later handling
-    return channel;
+    // Voices are grouped by AudioEnum for easier access later
+    return m_mixer.PlayVoice(sample, static_cast<int>(audioID), GetAudioPriority(audioID), shouldLoop);
 }
 
 
 //-----------------------------------------------------------------------------
-// Stops audio playing on a specific channel
+// Stops audio started by a specific Play() call
 //-----------------------------------------------------------------------------
-void AudioManager::Stop(int channel)
+void AudioManager::Stop(uint32_t playID)
 {
-    Mix_HaltChannel(channel);
+    m_mixer.StopVoice(playID);
 }
 
 
 //-----------------------------------------------------------------------------
-// Stops audio playing on grouped channels specified by an AudioEnum
+// Stops audio playing on grouped voices specified by an AudioEnum
 //-----------------------------------------------------------------------------
 void AudioManager::Stop(AudioEnum audioID)
 {
-    Mix_HaltGroup(static_cast<int>(audioID));
+    m_mixer.StopGroup(static_cast<int>(audioID));
 }
 
 
@@ -147,29 +131,30 @@ void AudioManager::Stop(AudioEnum audioID)
 //-----------------------------------------------------------------------------
 void AudioManager::StopAll()
 {
-    for (int i = 0; i < static_cast<int>(AudioEnum::AUDIO_ENUM_COUNT); i++)
-    {
-        Stop(static_cast<AudioEnum>(i));
-    }
+    m_mixer.StopAllVoices();
 }
 
 
 //-----------------------------------------------------------------------------
-// Removes one Mix_Chunks specified by an AudioEnum
+// Removes one AudioSample specified by an AudioEnum
 //-----------------------------------------------------------------------------
 void AudioManager::UnloadAudio(AudioEnum audioID)
 {
-    Mix_Chunk*& audioChunk = m_audioChunks[static_cast<int>(audioID)];
-    if (audioChunk != nullptr)
+    AudioSample& sample = m_samples[static_cast<int>(audioID)];
+    if (sample.IsLoaded())
     {
-        Mix_FreeChunk(audioChunk);
-        audioChunk = nullptr;
+        // Voices playing the sample would read freed memory otherwise
+        m_mixer.StopSample(sample);
+
+        sample.data.clear();
+        sample.data.shrink_to_fit();
+        sample.frameCount = 0;
     }
 }
 
 
 //-----------------------------------------------------------------------------
-// Used to remove all Mix_Chunks when game ends
+// Used to remove all AudioSamples when game ends
 //-----------------------------------------------------------------------------
 void AudioManager::UnloadAllAudio()
 {
@@ -204,3 +189,23 @@ std::string AudioManager::GetAudioFilepath(AudioEnum audioID) const
         return "";
     }
 }
+
+
+//-----------------------------------------------------------------------------
+// Helper function to match AudioEnums to priorities, cues the player has to
+// hear can steal voices from shotgun and enemy sounds but not the other way
+//-----------------------------------------------------------------------------
+AudioPriority AudioManager::GetAudioPriority(AudioEnum audioID) const
+{
+    switch (audioID)
+    {
+    case AudioEnum::Music:          return AudioPriority::Critical;
+    case AudioEnum::GameOver:       return AudioPriority::Critical;
+    case AudioEnum::KeyPickedUp:    return AudioPriority::High;
+    case AudioEnum::AmmoPickedUp:   return AudioPriority::High;
+    case AudioEnum::ShotgunReload:  return AudioPriority::High;
+    case AudioEnum::ShotgunShoot:   return AudioPriority::Normal;
+    case AudioEnum::EnemyKilled:    return AudioPriority::Normal;
+    default:                        return AudioPriority::Low;
+    }
+}
@@ -0,0 +1,468 @@
+#include "AudioMixer.h"
+#include <algorithm>
+#include <iostream>
+
+// Picks the SIMD instruction set used for the mixing loops,
+// falls back to plain scalar loops if neither is available
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define AUDIO_MIXER_SSE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AUDIO_MIXER_NEON
+#endif
+
+//-----------------------------------------------------------------------------
+// Adds count samples from src, scaled by gain, on top of dst
+//-----------------------------------------------------------------------------
+static void MixAdd(float* dst, const float* src, int count, float gain)
+{
+    int i = 0;
+
+#if defined(AUDIO_MIXER_SSE)
+    const __m128 gains = _mm_set1_ps(gain);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 mixed = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), gains));
+        _mm_storeu_ps(dst + i, mixed);
+    }
+#elif defined(AUDIO_MIXER_NEON)
+    const float32x4_t gains = vdupq_n_f32(gain);
+    for (; i + 4 <= count; i += 4)
+    {
+        vst1q_f32(dst + i, vmlaq_f32(vld1q_f32(dst + i), vld1q_f32(src + i), gains));
+    }
+#endif
+
+    // Leftover samples that didn't fill a full SIMD register
+    for (; i < count; i++)
+    {
+        dst[i] += src[i] * gain;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Clamps count samples in buffer to -1.0 - 1.0, so that loud mixes clip
+// instead of wrapping around
+//-----------------------------------------------------------------------------
+static void ClampSamples(float* buffer, int count)
+{
+    int i = 0;
+
+#if defined(AUDIO_MIXER_SSE)
+    const __m128 low = _mm_set1_ps(-1.0f);
+    const __m128 high = _mm_set1_ps(1.0f);
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(buffer + i, _mm_max_ps(low, _mm_min_ps(high, _mm_loadu_ps(buffer + i))));
+    }
+#elif defined(AUDIO_MIXER_NEON)
+    const float32x4_t low = vdupq_n_f32(-1.0f);
+    const float32x4_t high = vdupq_n_f32(1.0f);
+    for (; i + 4 <= count; i += 4)
+    {
+        vst1q_f32(buffer + i, vmaxq_f32(low, vminq_f32(high, vld1q_f32(buffer + i))));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        buffer[i] = std::clamp(buffer[i], -1.0f, 1.0f);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Opens the default playback device with a stream in the devices sample
+// rate, so that SDL never has to resample while the game is running
+// SDL audio subsystem has to be initialized before calling this
+//-----------------------------------------------------------------------------
+bool AudioMixer::Init()
+{
+    // Uses the device sample rate if it can be queried, otherwise keeps 48kHz
+    SDL_AudioSpec deviceSpec;
+    int deviceFrames = 0;
+    if (SDL_GetAudioDeviceFormat(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &deviceSpec, &deviceFrames))
+    {
+        m_spec.freq = deviceSpec.freq;
+    }
+
+    m_stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &m_spec, AudioCallback, this);
+    if (!m_stream)
+    {
+        std::cerr << "SDL_OpenAudioDeviceStream failed! Error: " << SDL_GetError() << '\n';
+        return false;
+    }
+
+    // Device streams start paused
+    if (!SDL_ResumeAudioStreamDevice(m_stream))
+    {
+        std::cerr << "SDL_ResumeAudioStreamDevice failed! Error: " << SDL_GetError() << '\n';
+        return false;
+    }
+
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Closes the audio device and stops every voice, the audio callback will
+// not be called after this returns
+//-----------------------------------------------------------------------------
+void AudioMixer::Destroy()
+{
+    if (m_stream)
+    {
+        SDL_DestroyAudioStream(m_stream);
+        m_stream = nullptr;
+    }
+
+    // Drops commands that never got applied
+    ApplyCommands();
+    for (Voice& voice : m_voices)
+    {
+        voice.active = false;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Loads a WAV file and converts it to the mixers format, so that the
+// audio callback only has to apply gain and add samples together
+//-----------------------------------------------------------------------------
+bool AudioMixer::LoadSample(const char* filepath, AudioSample& sample) const
+{
+    SDL_AudioSpec wavSpec;
+    Uint8* wavData = nullptr;
+    Uint32 wavLength = 0;
+
+    // Attempts to load the WAV file
+    if (!SDL_LoadWAV(filepath, &wavSpec, &wavData, &wavLength))
+    {
+        std::cerr << "SDL_LoadWAV failed! Error: " << SDL_GetError() << '\n';
+        return false;
+    }
+
+    // Converts samples to float32 stereo in the device sample rate
+    Uint8* convertedData = nullptr;
+    int convertedLength = 0;
+    bool converted = SDL_ConvertAudioSamples(&wavSpec, wavData, static_cast<int>(wavLength), &m_spec, &convertedData, &convertedLength);
+    SDL_free(wavData);
+
+    if (!converted)
+    {
+        std::cerr << "SDL_ConvertAudioSamples failed for " << filepath << "! Error: " << SDL_GetError() << '\n';
+        return false;
+    }
+
+    const float* samples = reinterpret_cast<const float*>(convertedData);
+    sample.frameCount = static_cast<uint32_t>(convertedLength / (sizeof(float) * CHANNELS));
+    sample.data.assign(samples, samples + sample.frameCount * CHANNELS);
+    SDL_free(convertedData);
+
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Queues a sample to start playing on the audio thread, returns an ID that
+// can be passed to StopVoice() or 0 if the command could not be queued
+// Voice stealing and dropping is decided by the audio thread
+//-----------------------------------------------------------------------------
+uint32_t AudioMixer::PlayVoice(const AudioSample& sample, int group, AudioPriority priority, bool looping, float gain)
+{
+    if (!m_stream || !sample.IsLoaded()) return 0;
+
+    AudioCommand command;
+    command.type     = AudioCommandType::Play;
+    command.priority = priority;
+    command.looping  = looping;
+    command.group    = group;
+    command.playID   = m_playCounter.fetch_add(1, std::memory_order_relaxed) + 1;
+    command.gain     = gain;
+    command.sample   = &sample;
+
+    return PushCommand(command) ? command.playID : 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Stops the voice started with playID, does nothing if it has already ended
+//-----------------------------------------------------------------------------
+void AudioMixer::StopVoice(uint32_t playID)
+{
+    AudioCommand command;
+    command.type = AudioCommandType::StopVoice;
+    command.playID = playID;
+    PushCommand(command);
+}
+
+
+//-----------------------------------------------------------------------------
+// Stops every voice that was started with the specified group
+//-----------------------------------------------------------------------------
+void AudioMixer::StopGroup(int group)
+{
+    AudioCommand command;
+    command.type = AudioCommandType::StopGroup;
+    command.group = group;
+    PushCommand(command);
+}
+
+
+//-----------------------------------------------------------------------------
+// Stops every voice
+//-----------------------------------------------------------------------------
+void AudioMixer::StopAllVoices()
+{
+    AudioCommand command;
+    command.type = AudioCommandType::StopAll;
+    PushCommand(command);
+}
+
+
+//-----------------------------------------------------------------------------
+// Stops every voice playing sample before returning, unlike StopGroup() it
+// can't be dropped by a full queue, so sample can be freed right after
+// Applies queued commands first so a queued play of sample can't start
+// later, takes the stream lock so only use it outside of gameplay
+//-----------------------------------------------------------------------------
+void AudioMixer::StopSample(const AudioSample& sample)
+{
+    // Audio callback holds the stream lock while it is running
+    if (m_stream) SDL_LockAudioStream(m_stream);
+
+    ApplyCommands();
+    for (Voice& voice : m_voices)
+    {
+        if (voice.sample == &sample) voice.active = false;
+    }
+
+    if (m_stream) SDL_UnlockAudioStream(m_stream);
+}
+
+
+//-----------------------------------------------------------------------------
+// Pushes a command onto the calling threads own queue, the first command
+// from a thread claims a queue for it
+//-----------------------------------------------------------------------------
+bool AudioMixer::PushCommand(const AudioCommand& command)
+{
+    if (!m_stream) return false;
+
+    static thread_local int s_queueIndex = -1;
+    if (s_queueIndex == -1)
+    {
+        s_queueIndex = m_producerCount.fetch_add(1, std::memory_order_acq_rel);
+        if (s_queueIndex >= MAX_PRODUCER_THREADS)
+        {
+            std::cerr << "More than " << MAX_PRODUCER_THREADS << " threads are posting audio commands!" << '\n';
+        }
+    }
+
+    if (s_queueIndex >= MAX_PRODUCER_THREADS || !m_commandQueues[s_queueIndex].Push(command))
+    {
+        m_overflowCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Drains every command queue, only call on the audio thread or while
+// holding the stream lock
+//-----------------------------------------------------------------------------
+void AudioMixer::ApplyCommands()
+{
+    int queueCount = std::min(m_producerCount.load(std::memory_order_acquire), MAX_PRODUCER_THREADS);
+
+    AudioCommand command;
+    for (int i = 0; i < queueCount; i++)
+    {
+        while (m_commandQueues[i].Pop(command))
+        {
+            switch (command.type)
+            {
+            case AudioCommandType::Play:
+                StartVoice(command);
+                break;
+            case AudioCommandType::StopVoice:
+                for (Voice& voice : m_voices)
+                {
+                    if (voice.playID == command.playID) voice.active = false;
+                }
+                break;
+            case AudioCommandType::StopGroup:
+                for (Voice& voice : m_voices)
+                {
+                    if (voice.group == command.group) voice.active = false;
+                }
+                break;
+            case AudioCommandType::StopAll:
+                for (Voice& voice : m_voices)
+                {
+                    voice.active = false;
+                }
+                break;
+            }
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Starts playing a sample on a free voice, steals the oldest voice of lowest
+// priority if all voices are busy, drops the command if every voice is
+// playing something more important
+//-----------------------------------------------------------------------------
+void AudioMixer::StartVoice(const AudioCommand& command)
+{
+    int index = -1;
+    for (int i = 0; i < MAX_VOICES; i++)
+    {
+        if (m_voices[i].active) continue;
+
+        index = i;
+        break;
+    }
+
+    // No free voices, attempt to steal one
+    if (index == -1)
+    {
+        index = FindVoiceToSteal(command.priority);
+        if (index != -1) m_stolenCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Counted so the game thread can report it, never print on the audio thread
+    if (index == -1)
+    {
+        m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Voice& voice = m_voices[index];
+    voice.sample   = command.sample;
+    voice.position = 0;
+    voice.playID   = command.playID;
+    voice.gain     = command.gain;
+    voice.group    = command.group;
+    voice.priority = command.priority;
+    voice.looping  = command.looping;
+    voice.active   = true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Returns the voice that has played the longest among the lowest priority
+// voices, never returns a voice with higher priority than priority
+//-----------------------------------------------------------------------------
+int AudioMixer::FindVoiceToSteal(AudioPriority priority) const
+{
+    int index = -1;
+    for (int i = 0; i < MAX_VOICES; i++)
+    {
+        const Voice& voice = m_voices[i];
+        if (voice.priority > priority) continue;
+
+        if (index == -1
+            || voice.priority < m_voices[index].priority
+            || (voice.priority == m_voices[index].priority && voice.playID < m_voices[index].playID))
+        {
+            index = i;
+        }
+    }
+
+    return index;
+}
+
+
+//-----------------------------------------------------------------------------
+// Called by SDL on the audio thread when the device needs more data,
+// mixes in chunks and measures how much of the buffers duration was spent
+// mixing
+//-----------------------------------------------------------------------------
+void SDLCALL AudioMixer::AudioCallback(void* userdata, SDL_AudioStream* stream, int additionalAmount, int totalAmount)
+{
+    AudioMixer* mixer = static_cast<AudioMixer*>(userdata);
+    const Uint64 startTime = SDL_GetPerformanceCounter();
+
+    // Applies everything gameplay posted since last callback
+    mixer->ApplyCommands();
+
+    const int frameSize = sizeof(float) * CHANNELS;
+    int framesNeeded = additionalAmount / frameSize;
+    int framesMixed = 0;
+
+    while (framesNeeded > 0)
+    {
+        int frameCount = std::min(framesNeeded, MIX_CHUNK_FRAMES);
+        mixer->MixChunk(frameCount);
+        SDL_PutAudioStreamData(stream, mixer->m_mixBuffer, frameCount * frameSize);
+
+        framesNeeded -= frameCount;
+        framesMixed += frameCount;
+    }
+
+    if (framesMixed == 0) return;
+
+    // Compares time spent mixing to how long the mixed audio will play for
+    double mixSeconds = static_cast<double>(SDL_GetPerformanceCounter() - startTime) / SDL_GetPerformanceFrequency();
+    double bufferSeconds = static_cast<double>(framesMixed) / mixer->m_spec.freq;
+    float load = static_cast<float>(mixSeconds / bufferSeconds);
+
+    // Smooths load over several callbacks so it can be read by the game
+    float smoothedLoad = mixer->m_callbackLoad.load(std::memory_order_relaxed) * 0.9f + load * 0.1f;
+    mixer->m_callbackLoad.store(smoothedLoad, std::memory_order_relaxed);
+    if (load > mixer->m_peakCallbackLoad.load(std::memory_order_relaxed))
+        mixer->m_peakCallbackLoad.store(load, std::memory_order_relaxed);
+}
+
+
+//-----------------------------------------------------------------------------
+// Mixes frameCount frames of every active voice into m_mixBuffer,
+// frameCount can be at most MIX_CHUNK_FRAMES
+//-----------------------------------------------------------------------------
+void AudioMixer::MixChunk(int frameCount)
+{
+    std::fill(m_mixBuffer, m_mixBuffer + frameCount * CHANNELS, 0.0f);
+
+    int activeVoices = 0;
+    for (Voice& voice : m_voices)
+    {
+        if (!voice.active) continue;
+
+        int framesWritten = 0;
+        while (framesWritten < frameCount)
+        {
+            const uint32_t framesLeft = voice.sample->frameCount - voice.position;
+            int framesToMix = std::min(static_cast<int>(framesLeft), frameCount - framesWritten);
+
+            MixAdd(m_mixBuffer + framesWritten * CHANNELS,
+                voice.sample->data.data() + voice.position * CHANNELS,
+                framesToMix * CHANNELS,
+                voice.gain);
+
+            framesWritten += framesToMix;
+            voice.position += framesToMix;
+
+            // Sample has reached the end, either loop or free the voice
+            if (voice.position >= voice.sample->frameCount)
+            {
+                if (!voice.looping)
+                {
+                    voice.active = false;
+                    break;
+                }
+                voice.position = 0;
+            }
+        }
+
+        if (voice.active) activeVoices++;
+    }
+
+    ClampSamples(m_mixBuffer, frameCount * CHANNELS);
+    m_activeVoiceCount.store(activeVoices, std::memory_order_relaxed);
+}
@@ -2,270 +2,368 @@
 #include "Shotgun.h"
 #include "Game.h"
 #include "AudioManager.h"
-#include <bitset>
+#include "Profiler.h"
+#include "Metrics.h"
 
 using namespace Primitives2D;
 
-//-----------------------------------------------------------------------------
-// Constructor, enemy stats are decided by the EnemyTypes passed,
-// also defines the enemy path and the unique enemy ID
-//-----------------------------------------------------------------------------
-Enemy::Enemy(EnemyTypes type, const LineSegment& path, uint16_t ID, Game* pGame)
-    : m_position(path.start)
-    , m_path(path)
-    , m_targetPosition(path.end)
-    , isDead(false)
-    , m_pGame(pGame)
-    , m_ID(ID)
+namespace
 {
-    switch (type)
-    {
-    case EnemyTypes::Fast:
-        SetStats(20.0f, 50.0f, 70.0f, 5, 2.5f, 60.0f);
-        m_currentState = EnemyStates::Normal;
-        break;
-    case EnemyTypes::Brute:
-        SetStats(25.0f, 35.0f, 40.0f, 20, 1.5f, 70.0f);
-        m_currentState = EnemyStates::Normal;
-        break;
-    case EnemyTypes::Boss:
-        SetStats(22.0f, 45.0f, 60.0f, 10, 1.0f, 70.0f);
-        m_currentState = EnemyStates::Normal;
-        break;
-    case EnemyTypes::Tutorial:
-        SetStats(22.0f, 0.0f, 0.0f, 10, 0.0f, 0.0f);
-        m_currentState = EnemyStates::Deactivated;
-        break;
-    default:
-        std::cerr << "Invalid enemy type!" << '\n';
-        SetStats(10.0f, 40.0f, 50.0f, 15, 2.0f, 60.0f);
-        break;
-    }
-}
+    // Indexed by EnemyTypes, the last entry is used for invalid types
+    // Hitbox radius, walking speed, chasing speed, health, idle time, fov, start state
+    const EnemyArchetype archetypes[static_cast<int>(EnemyTypes::ENEMY_TYPES_COUNT) + 1] = {
+        { 20.0f, 50.0f, 70.0f,  5, 2.5f, 60.0f, EnemyStates::Normal      }, // Fast
+        { 25.0f, 35.0f, 40.0f, 20, 1.5f, 70.0f, EnemyStates::Normal      }, // Brute
+        { 22.0f, 45.0f, 60.0f, 10, 1.0f, 70.0f, EnemyStates::Normal      }, // Boss
+        { 22.0f,  0.0f,  0.0f, 10, 0.0f,  0.0f, EnemyStates::Deactivated }, // Tutorial
+        { 10.0f, 40.0f, 50.0f, 15, 2.0f, 60.0f, EnemyStates::Normal      }  // Invalid
+    };
 
 
-//-----------------------------------------------------------------------------
-// Checks for shotgun ray collisions, runs state machine for idle,
-// chasing and normal, updates sight raycast and enemy position
-//-----------------------------------------------------------------------------
-void Enemy::Update(float deltaTime, const Player& player, const std::vector<Rect>& environment, const Shotgun& playerShotgun)
-{
-    // Checks for collisions with shotgun rays
-    const std::vector<ShotgunBlast>& blasts = playerShotgun.GetShotgunBlastsRef();
-    for (const ShotgunBlast& blast : blasts)
+    //-----------------------------------------------------------------------------
+    // Checks if enemy is close enough to its target position
+    //-----------------------------------------------------------------------------
+    bool HasReachedTarget(const EnemyBody& body)
     {
-        const std::vector<LineSegment>& lines = blast.collisionRays.GetRays();
-        for (const LineSegment& line : lines)
-        {
-            if (!CheckLineCircleCollision(line, m_hitbox).result) continue;
-            m_health--;
-            m_targetPosition = player.GetOrigin();
-        }
+        return (body.hitbox.center - body.targetPosition).Length() <= 2.0f;
     }
 
-    // No need to continue updating if enemy is already dead
-    if (m_health <= 0)
+
+    //-----------------------------------------------------------------------------
+    // Enemy walks in a straight line, from it's current position to waypoint
+    //-----------------------------------------------------------------------------
+    void FollowPath(EnemyBody& body, const Vec2& waypoint, float speed)
     {
-        m_pGame->GetUnlockedObjects().set(static_cast<int>(GameObjects::GameObjectsEnum::Enemies) * 65536 + m_ID);
-        isDead = true;
-        AudioManager::GetInstance().Play(AudioEnum::EnemyKilled);
-        return;
+        const Vec2 direction = waypoint - body.hitbox.center;
+
+        if (direction.Length() > 0.001f)
+            body.velocity = direction.Normalized() * speed * 7.5f;
     }
 
-    // Used for tutorial enemies, do nothing
-    if (m_currentState == EnemyStates::Deactivated) return;
 
-    m_sight.ResetRays();
-    m_lastState = m_currentState;
+    //-----------------------------------------------------------------------------
+    // Enemy stands completely still for idleTime seconds
+    //-----------------------------------------------------------------------------
+    void Idle(EnemyBody& body, EnemyBrain& brain, const EnemyArchetype& stats, float deltaTime)
+    {
+        body.velocity = Vec2::Zero(); // Always stop while idling
 
-    bool canSeePlayer = CheckIfSeesPlayer(player, environment);
-    bool hasReachedTarget = HasReachedTarget();
+        // If we just entered idle state, reset the timer
+        if (brain.lastState != EnemyStates::Idle)
+        {
+            brain.idleTimer = stats.idleTime;
+        }
 
-    // State machine with clearer logic than before
-    if (canSeePlayer)
-    {
-        m_currentState = EnemyStates::Chasing;
-        ChasePlayer(deltaTime, player.GetOrigin());
-    }
-    else if (m_currentState == EnemyStates::Idle)
-    {
-        // Continue idling until timer expires
-        Idle(deltaTime);
+        // Always decrement timer while idling
+        brain.idleTimer -= deltaTime;
 
-        // Exit idle when timer is done
-        if (m_idleTimer <= 0.0f)
+        // When timer expires, switch target
+        if (brain.idleTimer <= 0.0f)
         {
-            m_currentState = EnemyStates::Normal;
-            // Timer will be reset next time we enter idle
+            body.targetPosition = (body.targetPosition == brain.path.end) ? brain.path.start : brain.path.end;
         }
     }
-    else if (hasReachedTarget)
+
+
+    //-----------------------------------------------------------------------------
+    // Sets player as target position and chasingSpeed as currentspeed, walks
+    // the flow field's path around walls instead of straight at the player
+    //-----------------------------------------------------------------------------
+    void ChasePlayer(EnemyBody& body, const EnemyArchetype& stats, const Vec2& playerPos, FlowField& flowField)
     {
-        // Enter idle state
-        m_currentState = EnemyStates::Idle;
-        Idle(deltaTime);
+        body.targetPosition = playerPos;
+        if (!HasReachedTarget(body))
+            FollowPath(body, flowField.GetWaypoint(body.hitbox.center), stats.chasingSpeed);
     }
-    else
+
+
+    //-----------------------------------------------------------------------------
+    // Checks if player is visible to enemy, sight works both ways so an
+    // enemy inside the fov that the player can see also sees the player
+    //-----------------------------------------------------------------------------
+    bool CheckIfSeesPlayer(const EnemyBody& body,
+        const EnemyArchetype& stats,
+        const Player& player,
+        const VisibilityPolygon& playerSight)
     {
-        // Normal patrolling
-        m_currentState = EnemyStates::Normal;
-        FollowPath(deltaTime, m_walkingSpeed);
+        Metrics::GetInstance().Add(MetricCounter::SightChecks);
+
+        const Vec2 position = body.hitbox.center;
+        const Vec2 playerPos = player.GetOrigin();
+
+        const Vec2 toPlayer = playerPos - position;
+
+        // Avoid division by zero
+        if (toPlayer.LengthSquared() < 0.001f) return false;
+
+        // Calculate direction to player
+        Vec2 toPlayerDir = toPlayer;
+        toPlayerDir.Normalize();
+
+        // Calculate the direction of the enemy's FOV center
+        Vec2 fovDirection = body.targetPosition - position;
+        fovDirection.Normalize();
+
+        // Calculate angle between fov direction and direction to player
+        float angleInRadians = acos(fovDirection.Dot(toPlayerDir));
+        float angleInDegrees = angleInRadians * (180.0f / PI);
+
+        // Check if player is outside FOV angle
+        if (angleInDegrees > stats.fov / 2.0f) return false;
+
+        return playerSight.IsVisible(position);
     }
+}
 
-    // Used for visualising sight/fov
-    m_sight.CastRaysAtVertices(m_position, environment, m_targetPosition, m_fov);
-    m_sight.SortRays();
 
-    // Applies velocity to positon
-    m_position += m_velocity * deltaTime;
-    m_hitbox.center = m_position;
-    m_velocity *= 0.95f;
+//-----------------------------------------------------------------------------
+// Returns the stats shared by every enemy of a type
+//-----------------------------------------------------------------------------
+const EnemyArchetype& Enemies::GetArchetype(EnemyTypes type)
+{
+    const int index = static_cast<int>(type);
+    const int count = static_cast<int>(EnemyTypes::ENEMY_TYPES_COUNT);
+    return archetypes[(index >= 0 && index < count) ? index : count];
 }
 
 
 //-----------------------------------------------------------------------------
-// Renders sight/fov and body
+// Adds an enemy, stats are decided by the EnemyTypes passed, also defines
+// the enemy path and the unique enemy ID
+// Sight buffers come from sightMemory and keep their capacity between casts
 //-----------------------------------------------------------------------------
-void Enemy::Render() const
+EntityHandle Enemies::Spawn(EnemyStore& enemies, EnemyTypes type, const LineSegment& path, uint32_t ID, std::pmr::memory_resource* sightMemory)
 {
-    // Used for tutorial enemies, don't render sight
-    if (m_currentState != EnemyStates::Deactivated)
+    if (static_cast<int>(type) >= static_cast<int>(EnemyTypes::ENEMY_TYPES_COUNT))
     {
-        m_sight.RenderGeometry();
-    }
-    
-    // Renders enemy body
-    const std::vector<LineSegment> shape = CreateUniformShape(m_position, static_cast<int>(m_hitbox.radius), 8);
-    for (const LineSegment& line : shape)
-    {
-        line.Render(255, 0, 0, 255);
+        std::cerr << "Invalid enemy type!" << '\n';
     }
+
+    const EnemyArchetype& stats = GetArchetype(type);
+
+    EnemyBody body;
+    body.hitbox = Circle(path.start, stats.hitboxRadius);
+    body.targetPosition = path.end;
+    body.currentState = stats.startState;
+    body.type = type;
+
+    EnemyBrain brain;
+    brain.path = path;
+    brain.idleTimer = stats.idleTime;
+    brain.health = stats.health;
+    brain.ID = ID;
+
+    // Spreads the sight checks of enemies spawned together over different steps
+    EnemyPerception perception;
+    perception.stepsUntilSight = static_cast<uint16_t>(ID % 8);
+
+    return enemies.Add(body, brain, EnemyPreviousPosition{ path.start }, perception, Raycast(sightMemory));
 }
 
 
 //-----------------------------------------------------------------------------
-// Checks if player is visible to enemy
+// Checks for shotgun ray collisions, removes dead enemies, runs state
+// machine for idle, chasing and normal, updates sight raycast and
+// enemy positions, each pass only touches the components it needs
+// enemyGrid has to be built from the enemies' current positions,
+// playerSight from the player's and flowField has to target the player
+// Sight checks and sight meshes only run when scheduler says so, enemies
+// act on their last sight check in between, enemies out of the player's
+// sight never check, events has to be set to playerSight
 //-----------------------------------------------------------------------------
-bool Enemy::CheckIfSeesPlayer(const Player& player, const std::vector<Rect>& environment)
+void Enemies::Update(EnemyStore& enemies, float deltaTime, const Player& player, std::span<const Rect> environment, const Shotgun& playerShotgun, EnemyGrid& enemyGrid, const VisibilityPolygon& playerSight, FlowField& flowField, PerceptionScheduler& scheduler, PerceptionEvents& events, Game* pGame)
 {
-    // Get the two points at the borders of circle radius
-    const Vec2 playerPos = player.GetOrigin();
-
-    const Vec2 toPlayer = playerPos - m_position;
+    PROFILE_ZONE("Enemies::Update");
 
-    // Avoid division by zero
-    if (toPlayer.LengthSquared() < 0.001f) return false;
+    std::span<EnemyBody> bodies = enemies.Get<EnemyBody>();
+    std::span<EnemyBrain> brains = enemies.Get<EnemyBrain>();
 
-    // Calculate direction to player
-    Vec2 toPlayerDir = toPlayer;
-    toPlayerDir.Normalize();
+    // Checks for collisions with shotgun rays, each pellet only tests the
+    // enemies in the grid cells it passes through
+    for (int blast = 0; blast < playerShotgun.GetBlastCount(); blast++)
+    {
+        if (!playerShotgun.BlastCollides(blast)) continue;
 
-    // Calculate the direction of the enemy's FOV center
-    Vec2 fovDirection = m_targetPosition - m_position;
-    fovDirection.Normalize();
+        for (const LineSegment& line : playerShotgun.GetBlastPellets(blast))
+        {
+            for (uint32_t i : enemyGrid.QueryLine(line))
+            {
+                brains[i].health--;
+                bodies[i].targetPosition = player.GetOrigin();
+            }
+        }
+    }
 
-    // Calculate angle between fov direction and direction to player
-    float angleInRadians = acos(fovDirection.Dot(toPlayerDir));
-    float angleInDegrees = angleInRadians * (180.0f / PI);
+    // Enemies that hear a noise look for the player right away
+    std::span<EnemyPerception> perceptions = enemies.Get<EnemyPerception>();
+    for (const Circle& noise : events.GetNoises())
+    {
+        const Rect noiseBounds(noise.center - Vec2(noise.radius, noise.radius), noise.radius * 2.0f, noise.radius * 2.0f);
+        for (uint32_t i : enemyGrid.Query(noiseBounds))
+        {
+            if ((bodies[i].hitbox.center - noise.center).LengthSquared() <= noise.radius * noise.radius)
+                perceptions[i].stepsUntilSight = 0;
+        }
+    }
+    events.ClearNoises();
 
-    // Check if player is outside FOV angle
-    if (angleInDegrees > m_fov / 2.0f) return false;
+    // Removes dead enemies, backwards since the last enemy takes a removed one's place
+    for (size_t i = enemies.Size(); i-- > 0;)
+    {
+        if (enemies.Get<EnemyBrain>()[i].health > 0) continue;
 
-    // Now do the ray casting checks for the visible player points
-    const LineSegment enemyToPlayer{ m_position, playerPos };
-    const LineSegment playerLine = enemyToPlayer.CreateCrossingLineSegment(playerPos, player.GetHitboxRadius() * 2);
+        pGame->GetWorldState().Insert(pGame->GetCurrentLevelID(), GameObjects::GameObjectsEnum::Enemies, enemies.Get<EnemyBrain>()[i].ID);
+        AudioManager::GetInstance().Play(AudioEnum::EnemyKilled);
+        enemies.RemoveAt(i);
+    }
 
-    Vec2 points[3] = {
-        playerPos,
-        playerLine.start,
-        playerLine.end
-    };
+    bodies = enemies.Get<EnemyBody>();
+    brains = enemies.Get<EnemyBrain>();
+    perceptions = enemies.Get<EnemyPerception>();
+    std::span<Raycast> sights = enemies.Get<Raycast>();
 
-    // Cast rays to player points
-    for (int i = 0; i < 3; i++)
+    // State machine and sight
+    for (size_t i = 0; i < bodies.size(); i++)
     {
-        // Check if ray hit player without obstacle
-        if (!m_sight.CastRayToPos(m_position, points[i], environment)) return true;
-    }
+        PROFILE_ZONE("Enemy::Update");
 
-    return false;
-}
+        EnemyBody& body = bodies[i];
 
+        // Used for tutorial enemies, do nothing
+        if (body.currentState == EnemyStates::Deactivated) continue;
 
-//-----------------------------------------------------------------------------
-// Enemy walks in a straight line, from it's current position to it's 
-// target position
-//-----------------------------------------------------------------------------
-void Enemy::FollowPath(float deltaTime, float speed)
-{
-    const Vec2 direction = m_targetPosition - m_position;
+        EnemyBrain& brain = brains[i];
+        EnemyPerception& perception = perceptions[i];
+        const EnemyArchetype& stats = GetArchetype(body.type);
 
-    if (direction.Length() > 0.001f)
-        m_velocity = direction.Normalized() * speed * 7.5f;
-}
+        brain.lastState = body.currentState;
 
+        // Enemy's sector just came into the player's sight, look right away
+        const bool isInPlayerSight = events.IsInPlayerSight(body.hitbox.center);
+        if (isInPlayerSight && !perception.wasInPlayerSight) perception.stepsUntilSight = 0;
+        perception.wasInPlayerSight = isInPlayerSight;
 
-//-----------------------------------------------------------------------------
-// Enemy stands completely still for m_idleTime seconds
-//-----------------------------------------------------------------------------
-void Enemy::Idle(float deltaTime)
-{
-    m_velocity = Vec2::Zero(); // Always stop while idling
+        if (perception.stepsUntilSight > 0)
+        {
+            perception.stepsUntilSight--;
+        }
+        else
+        {
+            // Enemies out of the player's sight can't see the player either
+            const float distanceToPlayer = (player.GetOrigin() - body.hitbox.center).Length();
+            perception.canSeePlayer = isInPlayerSight && CheckIfSeesPlayer(body, stats, player, playerSight);
+            perception.stepsUntilSight = PerceptionScheduler::GetSightInterval(body.currentState, distanceToPlayer) - 1;
+            perception.isMeshDue = true;
+        }
 
-    // If we just entered idle state, reset the timer
-    if (m_lastState != EnemyStates::Idle)
-    {
-        m_idleTimer = m_idleTime;
+        if (!isInPlayerSight) perception.canSeePlayer = false;
+
+        bool canSeePlayer = perception.canSeePlayer;
+        bool hasReachedTarget = HasReachedTarget(body);
+
+        // State machine with clearer logic than before
+        if (canSeePlayer)
+        {
+            body.currentState = EnemyStates::Chasing;
+            ChasePlayer(body, stats, player.GetOrigin(), flowField);
+        }
+        else if (body.currentState == EnemyStates::Idle)
+        {
+            // Continue idling until timer expires
+            Idle(body, brain, stats, deltaTime);
+
+            // Exit idle when timer is done
+            if (brain.idleTimer <= 0.0f)
+            {
+                body.currentState = EnemyStates::Normal;
+                // Timer will be reset next time we enter idle
+            }
+        }
+        else if (hasReachedTarget)
+        {
+            // Enter idle state
+            body.currentState = EnemyStates::Idle;
+            Idle(body, brain, stats, deltaTime);
+        }
+        else
+        {
+            // Normal patrolling
+            body.currentState = EnemyStates::Normal;
+            FollowPath(body, body.targetPosition, stats.walkingSpeed);
+        }
     }
 
-    // Always decrement timer while idling
-    m_idleTimer -= deltaTime;
+    // Sight meshes are only used for visualising sight/fov, so they are
+    // recast in the scheduler's order until the frame's budget runs out, at
+    // least one always is every step so every mesh gets its turn
+    std::span<const uint32_t> dueMeshes = scheduler.ScheduleMeshes(bodies, perceptions, player.GetOrigin());
+    for (size_t n = 0; n < dueMeshes.size(); n++)
+    {
+        if (n > 0 && !scheduler.HasBudgetLeft())
+        {
+            scheduler.Defer(dueMeshes.subspan(n), perceptions);
+            break;
+        }
+
+        const uint32_t i = dueMeshes[n];
+        sights[i].CastRaysAtVertices(bodies[i].hitbox.center, environment, bodies[i].targetPosition, GetArchetype(bodies[i].type).fov);
+        sights[i].SortRays();
+        perceptions[i].isMeshDue = false;
+        perceptions[i].meshStepsWaited = 0;
+    }
 
-    // When timer expires, switch target
-    if (m_idleTimer <= 0.0f)
+    // Applies velocity to positon, deactivated enemies never get any velocity
+    std::span<EnemyPreviousPosition> previousPositions = enemies.Get<EnemyPreviousPosition>();
+    for (size_t i = 0; i < bodies.size(); i++)
     {
-        m_targetPosition = (m_targetPosition == m_path.end) ? m_path.start : m_path.end;
+        previousPositions[i].center = bodies[i].hitbox.center;
+        bodies[i].hitbox.center += bodies[i].velocity * deltaTime;
+        bodies[i].velocity *= 0.95f;
     }
 }
 
 
 //-----------------------------------------------------------------------------
-// Sets player as target position and m_chasingSpeed as currentspeed
+// Renders sight/fov and body of every enemy, bodies are drawn alpha of the
+// way from their last position to their current one
+// Sight meshes aren't recast every step, so they are moved along with the
+// body from where they were cast
 //-----------------------------------------------------------------------------
-void Enemy::ChasePlayer(float deltaTime, const Vec2& playerPos)
+void Enemies::Render(const EnemyStore& enemies, float alpha)
 {
-    m_targetPosition = playerPos;
-    if (!HasReachedTarget())
-        FollowPath(deltaTime, m_chasingSpeed);
-}
+    std::span<const EnemyBody> bodies = enemies.Get<EnemyBody>();
+    std::span<const EnemyPreviousPosition> previousPositions = enemies.Get<EnemyPreviousPosition>();
+    std::span<const Raycast> sights = enemies.Get<Raycast>();
 
+    for (size_t i = 0; i < bodies.size(); i++)
+    {
+        const Vec2 previous = previousPositions[i].center;
+        const Vec2 center = previous + (bodies[i].hitbox.center - previous) * alpha;
 
-//-----------------------------------------------------------------------------
-// Function to more easily set enemy stats in constructor
-//-----------------------------------------------------------------------------
-void Enemy::SetStats(float hitboxRadius, 
-                     float walkingSpeed,  
-                     float chasingSpeed, 
-                     int health, 
-                     float idleTime,
-                     float fov)
-{
-    m_hitbox           = { m_position, hitboxRadius};
-    m_walkingSpeed     = walkingSpeed;
-    m_chasingSpeed     = chasingSpeed;
-    m_health           = health;
-    m_idleTime         = idleTime;
-    m_idleTimer        = idleTime;
-    m_fov              = fov;
+        // Used for tutorial enemies, don't render sight, new enemies have no
+        // mesh until their first sight check
+        if (bodies[i].currentState != EnemyStates::Deactivated && sights[i].GetRayCount() > 1)
+        {
+            sights[i].RenderGeometry(center - sights[i].GetOrigin());
+        }
+
+        // Renders enemy body
+        LineSegment shape[8];
+        CreateUniformShape(center, static_cast<int>(bodies[i].hitbox.radius), shape);
+        for (const LineSegment& line : shape)
+        {
+            line.Render(255, 0, 0, 255);
+        }
+    }
 }
 
 
 //-----------------------------------------------------------------------------
-// Maps strings to EnemyTypes, used for clearer labeling in level json files 
+// Maps strings to EnemyTypes, used for clearer labeling in level json files
 //-----------------------------------------------------------------------------
-const std::unordered_map<std::string, EnemyTypes> Enemy::enemyMap = {
+const std::unordered_map<std::string, EnemyTypes> Enemies::enemyMap = {
     { "Fast",      EnemyTypes::Fast     },
     { "Brute",     EnemyTypes::Brute    },
     { "Boss",      EnemyTypes::Boss     },
     { "Tutorial",  EnemyTypes::Tutorial }
-};
\ No newline at end of file
+};
@@ -0,0 +1,215 @@
+#include "EnemyGrid.h"
+#include "Enemy.h"
+#include <algorithm>
+#include <limits>
+
+using namespace Primitives2D;
+
+namespace
+{
+    //-----------------------------------------------------------------------------
+    // Gets the box around a hitbox, what decides which cells it's put in
+    //-----------------------------------------------------------------------------
+    Rect GetCircleBounds(const Circle& circle)
+    {
+        Rect bounds;
+        bounds.min = circle.center - Vec2(circle.radius, circle.radius);
+        bounds.max = circle.center + Vec2(circle.radius, circle.radius);
+        return bounds;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Constructor, every list lives in memory, normally the level arena
+//-----------------------------------------------------------------------------
+EnemyGrid::EnemyGrid(std::pmr::memory_resource* memory)
+    : m_hitboxes(memory)
+    , m_bucketStart(memory)
+    , m_items(memory)
+    , m_queryStamps(memory)
+    , m_results(memory)
+{
+    static_assert((m_BUCKET_COUNT & (m_BUCKET_COUNT - 1)) == 0, "m_BUCKET_COUNT has to be a power of 2");
+}
+
+
+//-----------------------------------------------------------------------------
+// Reserves every list, small hitboxes are in at most 4 cells
+//-----------------------------------------------------------------------------
+void EnemyGrid::Reserve(size_t enemyCount)
+{
+    m_hitboxes.reserve(enemyCount);
+    m_bucketStart.reserve(m_BUCKET_COUNT + 1);
+    m_items.reserve(enemyCount * 4);
+    m_queryStamps.reserve(enemyCount);
+    m_results.reserve(enemyCount);
+}
+
+
+//-----------------------------------------------------------------------------
+// Sorts every hitbox into the buckets of the cells it touches, counts
+// them first so each bucket's enemies end up next to each other
+//-----------------------------------------------------------------------------
+void EnemyGrid::Build(std::span<const EnemyBody> bodies)
+{
+    m_hitboxes.resize(bodies.size());
+    for (size_t i = 0; i < bodies.size(); i++)
+    {
+        m_hitboxes[i] = bodies[i].hitbox;
+    }
+
+    m_queryStamps.assign(bodies.size(), 0);
+    m_queryStamp = 0;
+    m_bucketStart.assign(m_BUCKET_COUNT + 1, 0);
+
+    // Counts enemies per bucket, then turns the counts into start offsets
+    for (const Circle& hitbox : m_hitboxes)
+    {
+        const Rect bounds = GetCircleBounds(hitbox);
+        for (int row = ToCell(bounds.min.y); row <= ToCell(bounds.max.y); row++)
+            for (int column = ToCell(bounds.min.x); column <= ToCell(bounds.max.x); column++)
+                m_bucketStart[GetBucket(column, row) + 1]++;
+    }
+
+    for (uint32_t bucket = 0; bucket < m_BUCKET_COUNT; bucket++)
+    {
+        m_bucketStart[bucket + 1] += m_bucketStart[bucket];
+    }
+
+    // Fills the buckets using each start as a cursor, every cursor ends up
+    // at the next bucket's start so they are shifted back afterwards
+    m_items.resize(m_bucketStart[m_BUCKET_COUNT]);
+    for (uint32_t i = 0; i < m_hitboxes.size(); i++)
+    {
+        const Rect bounds = GetCircleBounds(m_hitboxes[i]);
+        for (int row = ToCell(bounds.min.y); row <= ToCell(bounds.max.y); row++)
+            for (int column = ToCell(bounds.min.x); column <= ToCell(bounds.max.x); column++)
+                m_items[m_bucketStart[GetBucket(column, row)]++] = i;
+    }
+
+    for (uint32_t bucket = m_BUCKET_COUNT; bucket > 0; bucket--)
+    {
+        m_bucketStart[bucket] = m_bucketStart[bucket - 1];
+    }
+    m_bucketStart[0] = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Adds every enemy in bucket that this query hasn't seen yet and passes test
+//-----------------------------------------------------------------------------
+template <typename Test>
+void EnemyGrid::VisitBucket(uint32_t bucket, Test&& test)
+{
+    for (uint32_t entry = m_bucketStart[bucket]; entry < m_bucketStart[bucket + 1]; entry++)
+    {
+        const uint32_t index = m_items[entry];
+        if (m_queryStamps[index] == m_queryStamp) continue;
+        m_queryStamps[index] = m_queryStamp;
+
+        if (test(index))
+            m_results.push_back(index);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Visits every cell area touches, enemies only get tested once even if they
+// are in several of those cells or share a bucket with another cell
+//-----------------------------------------------------------------------------
+std::span<const uint32_t> EnemyGrid::Query(const Rect& area)
+{
+    m_results.clear();
+    if (m_hitboxes.empty()) return m_results;
+
+    NextQuery();
+    for (int row = ToCell(area.min.y); row <= ToCell(area.max.y); row++)
+    {
+        for (int column = ToCell(area.min.x); column <= ToCell(area.max.x); column++)
+        {
+            VisitBucket(GetBucket(column, row), [&](uint32_t index)
+            {
+                return CheckRectRectCollision(GetCircleBounds(m_hitboxes[index]), area);
+            });
+        }
+    }
+
+    return m_results;
+}
+
+
+//-----------------------------------------------------------------------------
+// Walks the cells line passes through from start to end, one column or row
+// at a time, whichever border line crosses first
+//-----------------------------------------------------------------------------
+std::span<const uint32_t> EnemyGrid::QueryLine(const LineSegment& line)
+{
+    m_results.clear();
+    if (m_hitboxes.empty()) return m_results;
+
+    NextQuery();
+    auto hitsLine = [&](uint32_t index) { return CheckLineCircleCollision(line, m_hitboxes[index]).result; };
+
+    int column = ToCell(line.start.x);
+    int row = ToCell(line.start.y);
+    const int endColumn = ToCell(line.end.x);
+    const int endRow = ToCell(line.end.y);
+    const int columnStep = endColumn > column ? 1 : -1;
+    const int rowStep = endRow > row ? 1 : -1;
+
+    // How far along line, 0 to 1, the next column/row border is and how far
+    // apart the borders are
+    const Vec2 direction = line.end - line.start;
+    const float infinity = std::numeric_limits<float>::infinity();
+    const float columnDelta = direction.x != 0.0f ? m_CELL_SIZE / std::abs(direction.x) : infinity;
+    const float rowDelta = direction.y != 0.0f ? m_CELL_SIZE / std::abs(direction.y) : infinity;
+    float nextColumn = direction.x != 0.0f ? ((column + (direction.x > 0.0f ? 1 : 0)) * m_CELL_SIZE - line.start.x) / direction.x : infinity;
+    float nextRow = direction.y != 0.0f ? ((row + (direction.y > 0.0f ? 1 : 0)) * m_CELL_SIZE - line.start.y) / direction.y : infinity;
+
+    // Always ends in the end cell, even if rounding picks the wrong border
+    const int steps = std::abs(endColumn - column) + std::abs(endRow - row);
+    VisitBucket(GetBucket(column, row), hitsLine);
+    for (int step = 0; step < steps; step++)
+    {
+        if (column != endColumn && (row == endRow || nextColumn < nextRow))
+        {
+            column += columnStep;
+            nextColumn += columnDelta;
+        }
+        else
+        {
+            row += rowStep;
+            nextRow += rowDelta;
+        }
+
+        VisitBucket(GetBucket(column, row), hitsLine);
+    }
+
+    return m_results;
+}
+
+
+//-----------------------------------------------------------------------------
+// Mixes a cell's coordinates into a bucket, neighbouring cells end up in
+// different buckets
+//-----------------------------------------------------------------------------
+uint32_t EnemyGrid::GetBucket(int column, int row)
+{
+    const uint32_t hash = (static_cast<uint32_t>(column) * 73856093u) ^ (static_cast<uint32_t>(row) * 19349663u);
+    return hash & (m_BUCKET_COUNT - 1);
+}
+
+
+//-----------------------------------------------------------------------------
+// Starts a new query, stamps from before wrapping around could match again
+// so they are cleared
+//-----------------------------------------------------------------------------
+void EnemyGrid::NextQuery()
+{
+    if (++m_queryStamp == 0)
+    {
+        std::fill(m_queryStamps.begin(), m_queryStamps.end(), 0);
+        m_queryStamp = 1;
+    }
+}
@@ -0,0 +1,235 @@
+#include "FlowField.h"
+#include "Profiler.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <functional>
+
+using namespace Primitives2D;
+
+//-----------------------------------------------------------------------------
+// Sizes the grid to fit every wall plus a border, cells grow when the level
+// is too big for m_MAX_CELLS, then marks every cell a wall overlaps
+//-----------------------------------------------------------------------------
+void FlowField::Build(std::span<const Rect> walls)
+{
+    PROFILE_ZONE("FlowField::Build");
+
+    m_targetCell = -1;
+    m_isDirty = false;
+    m_cellSize = m_MIN_CELL_SIZE;
+    m_columns = 0;
+    m_rows = 0;
+
+    if (!walls.empty())
+    {
+        Vec2 worldMin = walls[0].min;
+        Vec2 worldMax = walls[0].max;
+        for (const Rect& wall : walls)
+        {
+            worldMin = Vec2(std::min(worldMin.x, wall.min.x), std::min(worldMin.y, wall.min.y));
+            worldMax = Vec2(std::max(worldMax.x, wall.max.x), std::max(worldMax.y, wall.max.y));
+        }
+
+        const Vec2 size = worldMax - worldMin;
+        do
+        {
+            m_columns = static_cast<int>(size.x / m_cellSize) + 1 + m_BORDER_CELLS * 2;
+            m_rows = static_cast<int>(size.y / m_cellSize) + 1 + m_BORDER_CELLS * 2;
+            if (static_cast<size_t>(m_columns) * m_rows <= m_MAX_CELLS) break;
+            m_cellSize *= 2.0f;
+        } while (true);
+
+        m_origin = worldMin - Vec2(m_BORDER_CELLS * m_cellSize, m_BORDER_CELLS * m_cellSize);
+    }
+
+    const size_t cellCount = static_cast<size_t>(m_columns) * m_rows;
+    m_walls.assign(walls.begin(), walls.end());
+    m_blocked.assign(cellCount, 0);
+    m_distances.assign(cellCount, m_UNREACHED);
+    m_nextCells.assign(cellCount, -1);
+    m_open.clear();
+    m_open.reserve(cellCount * 2);
+
+    for (const Rect& wall : walls)
+    {
+        const int minColumn = static_cast<int>((wall.min.x - m_origin.x) / m_cellSize);
+        const int maxColumn = static_cast<int>((wall.max.x - m_origin.x) / m_cellSize);
+        const int minRow = static_cast<int>((wall.min.y - m_origin.y) / m_cellSize);
+        const int maxRow = static_cast<int>((wall.max.y - m_origin.y) / m_cellSize);
+
+        for (int row = minRow; row <= maxRow; row++)
+            for (int column = minColumn; column <= maxColumn; column++)
+                m_blocked[row * m_columns + column] = 1;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Moves the target, paths are only recomputed once they are needed and the
+// target has moved into another cell
+//-----------------------------------------------------------------------------
+void FlowField::SetTarget(const Vec2& target)
+{
+    m_target = target;
+
+    const int cell = GetCell(target);
+    if (cell == m_targetCell) return;
+
+    m_targetCell = cell;
+    m_isDirty = true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Looks up the next cell on the path from position, enemies in a cell
+// without a path, e.g. one touching a wall, head for the best neighbour
+//-----------------------------------------------------------------------------
+Vec2 FlowField::GetWaypoint(const Vec2& position)
+{
+    if (m_isDirty) ComputePaths();
+
+    const int cell = GetCell(position);
+    if (cell < 0 || m_targetCell < 0 || cell == m_targetCell) return m_target;
+
+    int next = m_nextCells[cell];
+    if (m_distances[cell] == m_UNREACHED)
+    {
+        const int column = cell % m_columns;
+        const int row = cell / m_columns;
+        uint32_t bestDistance = m_UNREACHED;
+
+        for (int rowOffset = -1; rowOffset <= 1; rowOffset++)
+        {
+            for (int columnOffset = -1; columnOffset <= 1; columnOffset++)
+            {
+                const int neighbourColumn = column + columnOffset;
+                const int neighbourRow = row + rowOffset;
+                if (neighbourColumn < 0 || neighbourColumn >= m_columns || neighbourRow < 0 || neighbourRow >= m_rows) continue;
+
+                const int neighbour = neighbourRow * m_columns + neighbourColumn;
+                if (m_distances[neighbour] >= bestDistance) continue;
+
+                bestDistance = m_distances[neighbour];
+                next = neighbour;
+            }
+        }
+
+        if (bestDistance == m_UNREACHED) return m_target;
+    }
+
+    return next == m_targetCell ? m_target : GetCellCenter(next);
+}
+
+
+//-----------------------------------------------------------------------------
+// Gets the cell position is in, -1 if it's outside the grid
+//-----------------------------------------------------------------------------
+int FlowField::GetCell(const Vec2& position) const
+{
+    const float column = std::floor((position.x - m_origin.x) / m_cellSize);
+    const float row = std::floor((position.y - m_origin.y) / m_cellSize);
+    if (column < 0.0f || column >= m_columns || row < 0.0f || row >= m_rows) return -1;
+
+    return static_cast<int>(row) * m_columns + static_cast<int>(column);
+}
+
+
+//-----------------------------------------------------------------------------
+// Checks if no wall is between the center of cell and the target
+//-----------------------------------------------------------------------------
+bool FlowField::CanSeeTarget(int cell) const
+{
+    const LineSegment toTarget(GetCellCenter(cell), m_target);
+    size_t rectTests = 0;
+    bool visible = true;
+
+    for (const Rect& wall : m_walls)
+    {
+        rectTests++;
+        if (CheckLineRectCollision(toTarget, wall).result)
+        {
+            visible = false;
+            break;
+        }
+    }
+
+    Metrics::GetInstance().Add(MetricCounter::RectTests, rectTests);
+    return visible;
+}
+
+
+//-----------------------------------------------------------------------------
+// Gets the center of a cell in world space
+//-----------------------------------------------------------------------------
+Vec2 FlowField::GetCellCenter(int cell) const
+{
+    const float column = static_cast<float>(cell % m_columns);
+    const float row = static_cast<float>(cell / m_columns);
+    return m_origin + Vec2((column + 0.5f) * m_cellSize, (row + 0.5f) * m_cellSize);
+}
+
+
+//-----------------------------------------------------------------------------
+// Dijkstra outwards from the target cell, every reached cell remembers the
+// cell it was reached from, which is the next cell on its path
+// Diagonal steps are only taken if they don't cut a wall's corner
+// Enemies next to the target cell walk straight at the target, so if a
+// wall is in the target cell, only neighbours that can see it are reached
+//-----------------------------------------------------------------------------
+void FlowField::ComputePaths()
+{
+    PROFILE_ZONE("FlowField::ComputePaths");
+    Metrics::GetInstance().Add(MetricCounter::FlowFieldUpdates);
+
+    m_isDirty = false;
+    std::fill(m_distances.begin(), m_distances.end(), m_UNREACHED);
+    std::fill(m_nextCells.begin(), m_nextCells.end(), -1);
+    m_open.clear();
+
+    if (m_targetCell < 0) return;
+
+    // The target cell is searched from even if it touches a wall
+    m_distances[m_targetCell] = 0;
+    m_open.push_back(static_cast<uint64_t>(m_targetCell));
+
+    while (!m_open.empty())
+    {
+        std::pop_heap(m_open.begin(), m_open.end(), std::greater<uint64_t>());
+        const uint64_t entry = m_open.back();
+        m_open.pop_back();
+
+        const uint32_t distance = static_cast<uint32_t>(entry >> 32);
+        const int cell = static_cast<int>(entry & 0xFFFFFFFF);
+
+        // Cell was reached by a shorter path after this entry was added
+        if (distance > m_distances[cell]) continue;
+
+        const int column = cell % m_columns;
+        const int row = cell / m_columns;
+
+        for (int rowOffset = -1; rowOffset <= 1; rowOffset++)
+        {
+            for (int columnOffset = -1; columnOffset <= 1; columnOffset++)
+            {
+                const int neighbourColumn = column + columnOffset;
+                const int neighbourRow = row + rowOffset;
+                if (neighbourColumn < 0 || neighbourColumn >= m_columns || neighbourRow < 0 || neighbourRow >= m_rows) continue;
+
+                const int neighbour = neighbourRow * m_columns + neighbourColumn;
+                if (neighbour == cell || m_blocked[neighbour]) continue;
+
+                const bool isDiagonal = columnOffset != 0 && rowOffset != 0;
+                if (isDiagonal && (m_blocked[row * m_columns + neighbourColumn] || m_blocked[neighbourRow * m_columns + column])) continue;
+                if (cell == m_targetCell && m_blocked[cell] && !CanSeeTarget(neighbour)) continue;
+
+                const uint32_t neighbourDistance = distance + (isDiagonal ? m_DIAGONAL_COST : m_STRAIGHT_COST);
+                if (neighbourDistance >= m_distances[neighbour]) continue;
+
+                m_distances[neighbour] = neighbourDistance;
+                m_nextCells[neighbour] = cell;
+                m_open.push_back(static_cast<uint64_t>(neighbourDistance) << 32 | static_cast<uint32_t>(neighbour));
+                std::push_heap(m_open.begin(), m_open.end(), std::greater<uint64_t>());
+            }
+        }
+    }
+}
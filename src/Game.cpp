@@ -2,21 +2,105 @@
 #include "Settings.h"
 #include "RendererManager.h"
 #include "AudioManager.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "Metrics.h"
+#include "Random.h"
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <rapidjson/document.h>
 #include <rapidjson/filereadstream.h> 
 
 using namespace Primitives2D;
 
+// Lets rapidjson allocate from a MemoryArena, nothing is freed
+// until the arena is
+class ArenaJsonAllocator
+{
+public:
+	static const bool kNeedFree = false;
+
+	explicit ArenaJsonAllocator(MemoryArena* arena = nullptr) : m_arena(arena) {}
+
+	void* Malloc(size_t size)
+	{
+		return size > 0 ? m_arena->allocate(size, alignof(std::max_align_t)) : nullptr;
+	}
+
+	void* Realloc(void* original, size_t originalSize, size_t newSize)
+	{
+		if (newSize <= originalSize) return original;
+
+		void* pointer = Malloc(newSize);
+		if (original) memcpy(pointer, original, originalSize);
+		return pointer;
+	}
+
+	static void Free(void*) {}
+
+private:
+	MemoryArena* m_arena;
+};
+
+using JsonPoolAllocator = rapidjson::MemoryPoolAllocator<ArenaJsonAllocator>;
+using JsonDocument = rapidjson::GenericDocument<rapidjson::UTF8<>, JsonPoolAllocator, ArenaJsonAllocator>;
+using JsonValue = JsonDocument::ValueType;
+
+//-----------------------------------------------------------------------------
+// Returns milliseconds between two SDL performance counter values
+//-----------------------------------------------------------------------------
+static float CounterToMs(uint64_t start, uint64_t end)
+{
+	return static_cast<float>(end - start) * 1000.0f / SDL_GetPerformanceFrequency();
+}
+
+
+//-----------------------------------------------------------------------------
+// FNV-1a hash, used for the per frame state checksum
+//-----------------------------------------------------------------------------
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
 
 //-----------------------------------------------------------------------------
 // Constructor, initalizes SDL video, TTF and audio, creates window, renderer,
 // hides cursor, resets m_unlockedObjects and loads main menu level
 //-----------------------------------------------------------------------------
-Game::Game()
+Game::Game(const LaunchOptions& options)
+	: m_savePath(options.savePath)
+	, m_runMode(options.mode)
+	, m_recordingPath(options.recordingPath)
 {
+	// Replays and allocation checks run headless, without a visible window or audio
+	const bool isHeadless = m_runMode == RunMode::Replay || m_runMode == RunMode::AllocCheck;
+
+	if (m_runMode == RunMode::Replay && !m_recording.Load(m_recordingPath.c_str()))
+	{
+		m_exitCode = 1;
+		return;
+	}
+
+	if (m_runMode == RunMode::AllocCheck && !AllocationTracker::IsEnabled())
+	{
+		std::cerr << "Allocation check needs a build with ENABLE_ALLOC_TRACKER!" << '\n';
+		m_exitCode = 1;
+		return;
+	}
+
+	if (isHeadless)
+		SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "dummy");
+
 	// Fullscreen is set in Settings.h
-	int flags = Settings::FULLSCREEN ? SDL_WINDOW_FULLSCREEN : 0 ;
+	int flags = Settings::FULLSCREEN && !isHeadless ? SDL_WINDOW_FULLSCREEN : 0 ;
 
 	// Initalizes SDL video
 	if (!SDL_Init(SDL_INIT_VIDEO))
@@ -27,14 +111,24 @@ Game::Game()
 	std::cout << "SDL video succesfully initialized!" << '\n';
 
 	// Initalize and load audio before creating window, because it's ugly otherwise
-	AudioManager::GetInstance().Init();
-	AudioManager::GetInstance().LoadAllAudio();
+	// Without audio every Play() call does nothing, which is what replays want
+	if (!isHeadless)
+	{
+		AudioManager::GetInstance().Init();
+		AudioManager::GetInstance().LoadAllAudio();
+	}
 
 	// Consider doing alot of this stuff before creating a window
 	Text::InitTextEngine();
 
-	// Sets all m_unlockedGameObjects bits to 0 and sets player pointer to this game
-	m_unlockedGameObjects.reset();
+	// Starts worker threads, main thread becomes worker 0
+	JobSystem::GetInstance().Init();
+
+	// Per frame metrics are written to a CSV file by a background thread
+	if (!options.metricsPath.empty())
+		Metrics::GetInstance().StartWriting(options.metricsPath.c_str());
+
+	// Sets player pointer to this game
 	m_player.SetGamePointer(this);
 
 
@@ -51,16 +145,49 @@ Game::Game()
 	RendererManager::GetInstance().Init(m_window);
 	AudioManager::GetInstance().Play(AudioEnum::Music);
 
+	// Seeds every random stream, replays use the seed they were recorded with
+	if (m_runMode == RunMode::Replay)
+	{
+		Random::SeedAll(m_recording.seed);
+	}
+	else
+	{
+		// Allocation checks always run the same way
+		bool fixedSeed = options.hasSeed || m_runMode == RunMode::AllocCheck;
+		m_recording.seed = fixedSeed ? options.seed : static_cast<uint32_t>(SDL_GetPerformanceCounter());
+		m_recording.startLevelID = options.startLevelID;
+
+		// Saves only continue normal play, recordings always start from nothing
+		uint16_t savedLevelID = 0;
+		if (m_runMode == RunMode::Play && !m_savePath.empty() && m_worldState.Load(m_savePath.c_str(), savedLevelID))
+		{
+			// Older saves could be written on the game over screen
+			if (savedLevelID == GAME_OVER_LEVEL_ID || savedLevelID == MISSING_LEVEL_ID)
+			{
+				m_worldState.Clear();
+				savedLevelID = 1;
+			}
+
+			std::cout << "Continuing from " << m_savePath << " on level " << savedLevelID << '\n';
+			m_recording.startLevelID = savedLevelID;
+		}
+		Random::SeedAll(m_recording.seed);
+	}
+
 	// Need to load this stuff after initalizing RendererManager
 	GameObjects::LoadTextures();
-	LoadLevel(1);
+	LoadLevel(m_recording.startLevelID);
 
 	// For initalizing delta time calculations
-	m_lastTime = SDL_GetTicks();
+	m_lastTime = m_runMode == RunMode::Replay ? m_recording.startTime : SDL_GetTicksNS();
+	m_recording.startTime = m_lastTime;
+	m_frameStartCounter = SDL_GetPerformanceCounter();
+	m_replayStartCounter = m_frameStartCounter;
 
 	SDL_HideCursor();
 
 	m_isRunning = true;
+	m_hasStarted = true;
 }
 
 
@@ -69,8 +196,31 @@ Game::Game()
 //-----------------------------------------------------------------------------
 Game::~Game()
 {
+	if (m_runMode == RunMode::Record)
+		m_recording.Save(m_recordingPath.c_str());
+
+	// Leaving through the exit door continues from the main menu next time,
+	// quitting on the game over screen starts over like dying does, and a
+	// missing level continues from the last level that loaded
+	// A game that failed to start never overwrites the save
+	if (m_runMode == RunMode::Play && m_hasStarted && !m_savePath.empty())
+	{
+		uint16_t savedLevelID = m_lastPlayableLevelID;
+		if (m_currentLevelID == 0) savedLevelID = 1;
+		if (m_currentLevelID == GAME_OVER_LEVEL_ID)
+		{
+			m_worldState.Clear();
+			savedLevelID = 1;
+		}
+
+		m_worldState.Save(m_savePath.c_str(), savedLevelID);
+	}
+
+	Metrics::GetInstance().StopWriting();
+
 	GameObjects::DestroyTextures();
 	AudioManager::GetInstance().Destroy();
+	JobSystem::GetInstance().Destroy();
 	RendererManager::GetInstance().Destroy();
 	SDL_DestroyWindow(m_window);
 	SDL_Quit();
@@ -80,49 +230,219 @@ Game::~Game()
 
 
 //-----------------------------------------------------------------------------
-// Main game loop, calculates delta time, updates player and enemies
+// Main game loop, runs as many fixed simulation steps as real time has
+// passed and renders once, in between the last two steps
 //-----------------------------------------------------------------------------
 void Game::Update()
 {
-	// Calculate delta time
-	m_currentTime = SDL_GetTicks();
-	m_deltaTime = (m_currentTime - m_lastTime) / 1000.0f;
+	PROFILE_ZONE("Game::Update");
+
+	// Hands last frame, including its rendering, to metrics and the performance overlay
+	uint64_t frameStart = SDL_GetPerformanceCounter();
+	m_frameTimings.frameMs = CounterToMs(m_frameStartCounter, frameStart);
+
+	AllocationTracker::FrameAllocations allocations = AllocationTracker::EndFrame();
+	Metrics::GetInstance().Add(MetricCounter::HeapAllocations, allocations.count);
+	EndMetricsFrame();
+
+	if (m_runMode == RunMode::AllocCheck)
+	{
+		CheckFrameAllocations(allocations);
+		if (!m_isRunning) return;
+	}
+
+	m_frameTimings = FrameTimings();
+	m_frameStartCounter = frameStart;
+
+	// Gets input for this frame, replays take it from the recording
+	InputFrame input;
+	if (m_runMode == RunMode::Replay)
+	{
+		if (!NextReplayInput(input)) return;
+	}
+	else if (m_runMode == RunMode::AllocCheck)
+	{
+		// No input at a fixed 60 fps, two steps every frame, events are still
+		// pumped but ignored
+		SDL_PumpEvents();
+		input.timestamp = m_lastTime + m_FIXED_STEP_NS * 2;
+		input.mousePos = m_mousePos;
+	}
+	else
+	{
+		input = PollInput();
+	}
+
+	// Time since last frame, capped so a long hitch doesn't run a burst of steps
+	m_currentTime = input.timestamp;
+	const uint64_t frameTime = m_currentTime - m_lastTime;
+	m_deltaTime = frameTime / 1000000000.0f;
 	m_lastTime = m_currentTime;
+	m_stepAccumulator += std::min(frameTime, m_FIXED_STEP_NS * m_MAX_STEPS_PER_FRAME);
 
-	HandleEvents();
-	
-	// Isolate circles
-	std::vector<Circle> enemyCircles(m_enemies.size());
-	for (size_t i = 0; i < m_enemies.size(); i++)
+	HandleEvents(input);
+	m_frameTimings.eventsMs = CounterToMs(frameStart, SDL_GetPerformanceCounter());
+
+	// Player's sight is built once per frame from where the last frame left
+	// the player, frames run the same steps in replays so it stays the same
+	UpdatePlayerSight();
+
+	// Player and enemy timings add up every step of the frame, so does the
+	// time spent recasting sight meshes
+	m_perceptionScheduler.StartFrameBudget();
+	while (m_stepAccumulator >= m_FIXED_STEP_NS && m_isRunning)
 	{
-		enemyCircles[i] = m_enemies[i].GetHitbox();
+		m_stepAccumulator -= m_FIXED_STEP_NS;
+		Step();
+	}
+	uint64_t stepsEnd = SDL_GetPerformanceCounter();
+
+	// No need to render if player has already quit the game
+	if (!m_isRunning)
+	{
+		FinishFrame(input);
+		return;
 	}
 
-	m_player.Update(m_environment, m_ammoCrates, m_keys, m_transitions, enemyCircles, m_mousePos, m_deltaTime);
+	m_frameTimings.enemyCount = static_cast<uint32_t>(m_enemies.Size());
+	m_frameTimings.blastCount = static_cast<uint32_t>(m_player.GetShotgunRef().GetBlastCount());
 
-	// No need to render or update enemies if player has already quit the game
+	m_perfOverlay.Update(m_deltaTime);
+
+	// Replays only care about game state, so skip rendering to run faster
+	if (m_runMode != RunMode::Replay)
+		Render(static_cast<float>(m_stepAccumulator) / m_FIXED_STEP_NS);
+	m_frameTimings.renderMs = CounterToMs(stepsEnd, SDL_GetPerformanceCounter());
+
+	FinishFrame(input);
+}
+
+
+//-----------------------------------------------------------------------------
+// Advances the game by one fixed step, applies held input and updates
+// player and enemies
+//-----------------------------------------------------------------------------
+void Game::Step()
+{
+	PROFILE_ZONE("Game::Step");
+
+	Metrics::GetInstance().Add(MetricCounter::SimulationSteps);
+	uint64_t stepStart = SDL_GetPerformanceCounter();
+
+	ApplyInput();
+
+	// Enemies only move at the end of Enemies::Update, so one grid serves
+	// both the player's contact checks and the shotgun hits, LoadLevel
+	// rebuilds it for the new level's enemies
+	m_enemyGrid.Build(m_enemies.Get<EnemyBody>());
+
+	m_player.Update(m_environment, m_ammoCrates, m_keys, m_transitions, m_enemyGrid, m_levelGrid, m_mousePos, m_FIXED_DELTA_TIME);
+
+	// Player can't change level while it's iterating over the current one
+	if (m_hasPendingLevel)
+	{
+		m_hasPendingLevel = false;
+		LoadLevel(m_pendingLevelID);
+	}
+
+	uint64_t playerEnd = SDL_GetPerformanceCounter();
+	m_frameTimings.playerMs += CounterToMs(stepStart, playerEnd);
+
+	// No need to update enemies if player has already quit the game
 	if (!m_isRunning) return;
 
-	// Updates every enemy currently loaded
-	for (size_t i = 0; i < m_enemies.size(); i++)
+	// Updates every enemy currently loaded, they see the player if the
+	// player can see them and chase it along the flow field, a level loaded
+	// this step has no sight yet
+	if (m_playerSight.IsEmpty()) UpdatePlayerSight();
+	m_flowField.SetTarget(m_player.GetOrigin());
+	Enemies::Update(m_enemies, m_FIXED_DELTA_TIME, m_player, m_environment, m_player.GetShotgunRef(), m_enemyGrid, m_playerSight, m_flowField, m_perceptionScheduler, m_perceptionEvents, this);
+	m_frameTimings.enemiesMs += CounterToMs(playerEnd, SDL_GetPerformanceCounter());
+}
+
+
+//-----------------------------------------------------------------------------
+// Sets gauges from last frame's timings, ends the metrics frame and passes
+// its counters on to the performance overlay
+//-----------------------------------------------------------------------------
+void Game::EndMetricsFrame()
+{
+	Metrics& metrics = Metrics::GetInstance();
+	const AudioMixer& mixer = AudioManager::GetInstance().GetMixer();
+
+	metrics.SetGauge(MetricGauge::FrameMs,       m_frameTimings.frameMs);
+	metrics.SetGauge(MetricGauge::EventsMs,      m_frameTimings.eventsMs);
+	metrics.SetGauge(MetricGauge::PlayerMs,      m_frameTimings.playerMs);
+	metrics.SetGauge(MetricGauge::EnemiesMs,     m_frameTimings.enemiesMs);
+	metrics.SetGauge(MetricGauge::RenderMs,      m_frameTimings.renderMs);
+	metrics.SetGauge(MetricGauge::Enemies,       static_cast<float>(m_frameTimings.enemyCount));
+	metrics.SetGauge(MetricGauge::ShotgunBlasts, static_cast<float>(m_frameTimings.blastCount));
+	metrics.SetGauge(MetricGauge::AudioVoices,   static_cast<float>(mixer.GetActiveVoiceCount()));
+	metrics.SetGauge(MetricGauge::AudioLoad,     mixer.GetCallbackLoad());
+	metrics.SetGauge(MetricGauge::LevelArenaBytes, static_cast<float>(m_levelArena.GetUsedBytes()));
+	metrics.EndFrame();
+
+	const MetricsFrame& frame = metrics.GetLastFrame();
+	m_frameTimings.raysCast  = static_cast<uint32_t>(frame.Get(MetricCounter::RaysCast));
+	m_frameTimings.wallTests = static_cast<uint32_t>(frame.Get(MetricCounter::RectTests));
+	m_frameTimings.drawCalls = static_cast<uint32_t>(frame.Get(MetricCounter::DrawCalls));
+	m_perfOverlay.AddFrame(m_frameTimings);
+}
+
+
+//-----------------------------------------------------------------------------
+// Fails the allocation check if a frame after the warmup allocated,
+// prints which zones allocated so the allocation can be found
+//-----------------------------------------------------------------------------
+void Game::CheckFrameAllocations(const AllocationTracker::FrameAllocations& allocations)
+{
+	// Frame 0 is everything before the first Update
+	uint32_t frame = m_allocCheckFrame++;
+	if (frame <= m_ALLOC_CHECK_WARMUP_FRAMES) return;
+
+	if (m_currentLevelID != m_recording.startLevelID)
+	{
+		std::cerr << "Allocation check failed, level " << m_recording.startLevelID << " changed to level "
+			<< m_currentLevelID << " at frame " << frame << ", pick a level that doesn't end by itself" << '\n';
+		m_exitCode = 1;
+		m_isRunning = false;
+		return;
+	}
+
+	if (allocations.count > 0)
 	{
-		m_enemies[i].Update(m_deltaTime, m_player, m_environment, m_player.GetShotgunRef());
-		if (m_enemies[i].isDead)
+		std::cerr << "Allocation check failed, frame " << frame << " made " << allocations.count
+			<< " allocations (" << allocations.bytes << " bytes)" << '\n';
+
+		AllocationTracker::ZoneAllocations zones[32];
+		size_t zoneCount = AllocationTracker::GetFrameZones(zones, 32);
+		for (size_t i = 0; i < zoneCount; i++)
 		{
-			m_enemies.erase(m_enemies.begin() + i);
-			i--;
+			std::cerr << "    " << zones[i].zone << ": " << zones[i].count << " allocations, " << zones[i].bytes << " bytes" << '\n';
 		}
+
+		m_exitCode = 1;
+		m_isRunning = false;
+		return;
 	}
 
-	Render();
+	if (frame == m_ALLOC_CHECK_WARMUP_FRAMES + m_ALLOC_CHECK_FRAMES)
+	{
+		std::cout << "Allocation check passed, " << m_ALLOC_CHECK_FRAMES << " frames on level "
+			<< m_recording.startLevelID << " without allocating" << '\n';
+		m_isRunning = false;
+	}
 }
 
 
 //-----------------------------------------------------------------------------
-// Called at end of Update, renders everything in the game
+// Called at end of Update, renders everything in the game, alpha is how
+// far real time is between the last step and the next one
 //-----------------------------------------------------------------------------
-void Game::Render() const
+void Game::Render(float alpha) const
 {
+	PROFILE_ZONE("Game::Render");
+
 	SDL_Renderer* renderer = RendererManager::GetInstance().GetRenderer();
 
 	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255); // Paints canvas white
@@ -132,33 +452,30 @@ void Game::Render() const
 	// Renders walls
 	for (const Primitives2D::Rect& wall : m_environment)
 	{
-		wall.Render(255, 255, 255, 255);
+		RenderRect(wall, 255, 255, 255, 255);
 	}
 
 	// Renders ammo crates
 	for (const GameObjects::AmmoCrate& ammoCrate : m_ammoCrates)
 	{
-		RenderTexture(ammoCrate, GameObjects::GameObjectsEnum::AmmoCrates);
+		RenderTexture(ammoCrate.bounds, GameObjects::GameObjectsEnum::AmmoCrates);
 	}
 
 	// Renders transition boxes
 	for (const GameObjects::TransitionBox& transitionBox : m_transitions)
 	{
-		if (!m_unlockedGameObjects.test(static_cast<int>(GameObjects::GameObjectsEnum::Keys) * 65536 + transitionBox.keyID))
-			transitionBox.Render(199, 8, 27, 255);
+		if (!m_worldState.Contains(m_currentLevelID, GameObjects::GameObjectsEnum::Keys, transitionBox.keyID))
+			RenderRect(transitionBox.bounds, 199, 8, 27, 255);
 	}
 
 	// Renders keys
 	for (const GameObjects::Key& key : m_keys)
 	{
-		RenderTexture(key, GameObjects::GameObjectsEnum::Keys);
+		RenderTexture(key.bounds, GameObjects::GameObjectsEnum::Keys);
 	}
 
 	// Renders enemies and enemy sight
-	for (const Enemy& enemy : m_enemies)
-	{
-		enemy.Render();
-	}
+	Enemies::Render(m_enemies, alpha);
 
 	// Render text
 	for (const Text& text : m_text)
@@ -167,24 +484,33 @@ void Game::Render() const
 			text.RenderTexture();
 	}
 
-	m_player.Render();
+	m_player.Render(alpha);
+
+	m_perfOverlay.Render();
 
 	SDL_RenderPresent(renderer);
 }
 
 
 //-----------------------------------------------------------------------------
-// Called at beginning of Update, handles all user input
+// Polls SDL events and keyboard state into an InputFrame, debug keys
+// are handled here since they don't affect the game state
 //-----------------------------------------------------------------------------
-void Game::HandleEvents()
+InputFrame Game::PollInput()
 {
+	PROFILE_ZONE("Game::PollInput");
+
+	InputFrame input;
+	input.timestamp = SDL_GetTicksNS();
+	input.mousePos = m_mousePos;
+
 	SDL_Event event;
 	while (SDL_PollEvent(&event))
 	{
 		switch (event.type)
 		{
 		case SDL_EVENT_QUIT:
-			m_isRunning = false;
+			input.quit = true;
 			break;
 		
 		// Captures mouse movement
@@ -192,7 +518,7 @@ void Game::HandleEvents()
 		{
 			float x, y;
 			SDL_GetMouseState(&x, &y);
-			m_mousePos = Vec2(x, y);
+			input.mousePos = Vec2(x, y);
 			break;
 		}
 
@@ -201,21 +527,88 @@ void Game::HandleEvents()
 			if (!m_mouseButtonPressed)
 			{
 				m_mouseButtonPressed = true;
-				m_player.Shoot(m_environment, m_mousePos);
+				input.shoot = true;
+				input.shootPos = input.mousePos;
 			}
 			break;
 
 		case SDL_EVENT_MOUSE_BUTTON_UP:
 			m_mouseButtonPressed = false;
 			break;
+
+		case SDL_EVENT_KEY_DOWN:
+			if (event.key.repeat) break;
+
+			// Shows/hides performance overlay
+			if (event.key.scancode == SDL_SCANCODE_F3)
+				m_perfOverlay.Toggle();
+
+#if defined(ENABLE_PROFILER)
+			// Dumps the last few seconds of profiler zones
+			if (event.key.scancode == SDL_SCANCODE_F9)
+				Profiler::GetInstance().WriteChromeTrace("profile.json");
+#endif
+			break;
 		}
 	}
 
 	// Gets keystate
 	const bool* keystate = SDL_GetKeyboardState(NULL);
 
+	if (keystate[SDL_SCANCODE_UP] || keystate[SDL_SCANCODE_W])    input.buttons |= INPUT_UP;
+	if (keystate[SDL_SCANCODE_DOWN] || keystate[SDL_SCANCODE_S])  input.buttons |= INPUT_DOWN;
+	if (keystate[SDL_SCANCODE_LEFT] || keystate[SDL_SCANCODE_A])  input.buttons |= INPUT_LEFT;
+	if (keystate[SDL_SCANCODE_RIGHT] || keystate[SDL_SCANCODE_D]) input.buttons |= INPUT_RIGHT;
+	if (keystate[SDL_SCANCODE_LSHIFT])                            input.buttons |= INPUT_SPRINT;
+	if (keystate[SDL_SCANCODE_R])                                 input.buttons |= INPUT_RELOAD;
+
+	return input;
+}
+
+
+//-----------------------------------------------------------------------------
+// Called at beginning of Update, takes a frame of user input, either
+// polled this frame or read from a recording, the simulation steps
+// apply it
+//-----------------------------------------------------------------------------
+void Game::HandleEvents(const InputFrame& input)
+{
+	PROFILE_ZONE("Game::HandleEvents");
+
+	if (input.quit)
+	{
+		m_isRunning = false;
+	}
+
+	// Shot goes towards where the mouse was when clicking, fired by the
+	// next step even if this frame runs none
+	if (input.shoot)
+	{
+		m_hasPendingShot = true;
+		m_pendingShotPos = input.shootPos;
+	}
+
+	m_mousePos = input.mousePos;
+	m_heldButtons = input.buttons;
+}
+
+
+//-----------------------------------------------------------------------------
+// Called at beginning of every step, fires pending shots and applies held
+// buttons, movement is applied every step the buttons are held
+//-----------------------------------------------------------------------------
+void Game::ApplyInput()
+{
+	if (m_hasPendingShot)
+	{
+		UpdatePlayerSight();
+		if (m_player.Shoot(m_playerSight, m_pendingShotPos))
+			m_perceptionEvents.PublishShot(m_player.GetOrigin());
+		m_hasPendingShot = false;
+	}
+
 	// For sprinting input
-	if (keystate[SDL_SCANCODE_LSHIFT])
+	if (m_heldButtons & INPUT_SPRINT)
 	{
 		m_player.SetCurrentSpeed(m_player.SPRINTING_SPEED);
 	}
@@ -225,50 +618,203 @@ void Game::HandleEvents()
 	}
 
 	// For reloading
-	if (!m_reloadPressed && keystate[SDL_SCANCODE_R])
+	if (!m_reloadPressed && (m_heldButtons & INPUT_RELOAD))
 	{
 		m_player.Reload();
 		m_reloadPressed = true;
 	}
-	else if (!keystate[SDL_SCANCODE_R])
+	else if (!(m_heldButtons & INPUT_RELOAD))
 	{
 		m_reloadPressed = false;
 	}
 
 	// Checks for WASD/arrowkeys movement input
-	if (keystate[SDL_SCANCODE_UP] || keystate[SDL_SCANCODE_W])
+	if (m_heldButtons & INPUT_UP)
 	{
-		m_player.Move(UP, m_deltaTime);
+		m_player.Move(UP, m_FIXED_DELTA_TIME);
 	}
-	if (keystate[SDL_SCANCODE_DOWN] || keystate[SDL_SCANCODE_S])
+	if (m_heldButtons & INPUT_DOWN)
 	{
-		m_player.Move(DOWN, m_deltaTime);
+		m_player.Move(DOWN, m_FIXED_DELTA_TIME);
 	}
-	if (keystate[SDL_SCANCODE_LEFT] || keystate[SDL_SCANCODE_A])
+	if (m_heldButtons & INPUT_LEFT)
 	{
-		m_player.Move(LEFT, m_deltaTime);
+		m_player.Move(LEFT, m_FIXED_DELTA_TIME);
 	}
-	if (keystate[SDL_SCANCODE_RIGHT] || keystate[SDL_SCANCODE_D])
+	if (m_heldButtons & INPUT_RIGHT)
 	{
-		m_player.Move(RIGHT, m_deltaTime);
+		m_player.Move(RIGHT, m_FIXED_DELTA_TIME);
 	}
 }
 
 
+//-----------------------------------------------------------------------------
+// Gets next frame of a replay, stops the game when the recording is empty
+//-----------------------------------------------------------------------------
+bool Game::NextReplayInput(InputFrame& input)
+{
+	if (m_replayFrame >= m_recording.GetFrameCount())
+	{
+		std::cout << "Recording has no frames left to replay" << '\n';
+		m_isRunning = false;
+		return false;
+	}
+
+	// Keeps the event queue from filling up, events themselves are ignored
+	SDL_PumpEvents();
+
+	input = m_recording.GetFrame(m_replayFrame);
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Called at end of every frame, records the frame or checks it against the
+// recording when replaying
+//-----------------------------------------------------------------------------
+void Game::FinishFrame(const InputFrame& input)
+{
+	if (m_runMode == RunMode::Play) return;
+
+	uint64_t checksum = ComputeStateChecksum();
+
+	if (m_runMode == RunMode::Record)
+	{
+		m_recording.AddFrame(input, checksum);
+		return;
+	}
+
+	// Stops at the first frame that doesn't match, later frames would differ anyway
+	uint64_t expected = m_recording.GetChecksum(m_replayFrame);
+	if (checksum != expected)
+	{
+		std::cerr << "Replay diverged at frame " << m_replayFrame << " of " << m_recording.GetFrameCount()
+			<< "! Expected checksum " << std::hex << expected << " got " << checksum << std::dec << '\n';
+		m_exitCode = 1;
+		m_isRunning = false;
+		return;
+	}
+
+	m_replayFrame++;
+
+	if (m_replayFrame == m_recording.GetFrameCount())
+	{
+		double seconds = static_cast<double>(SDL_GetPerformanceCounter() - m_replayStartCounter) / SDL_GetPerformanceFrequency();
+		std::cout << "Replay finished, all " << m_replayFrame << " frames matched in " << seconds << "s ("
+			<< m_replayFrame / seconds << " frames per second)" << '\n';
+		m_isRunning = false;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Hashes the parts of the game state that gameplay changes, two runs with
+// the same input and seed must produce the same checksum every frame
+//-----------------------------------------------------------------------------
+uint64_t Game::ComputeStateChecksum() const
+{
+	uint64_t hash = 14695981039346656037ULL;
+	auto add = [&hash](const auto& value) { hash = HashBytes(hash, &value, sizeof(value)); };
+
+	add(m_currentLevelID);
+	add(m_player.GetOrigin().x);
+	add(m_player.GetOrigin().y);
+
+	const Shotgun& shotgun = m_player.GetShotgunRef();
+	add(shotgun.GetCurrentMagAmmo());
+	add(shotgun.GetCurrentReserveAmmo());
+	for (int blast = 0; blast < shotgun.GetBlastCount(); blast++)
+	{
+		add(shotgun.GetBlastAlpha(blast));
+		for (const LineSegment& ray : shotgun.GetBlastPellets(blast))
+		{
+			add(ray.end.x);
+			add(ray.end.y);
+		}
+	}
+
+	for (const EnemyBody& body : m_enemies.Get<EnemyBody>())
+	{
+		add(body.hitbox.center.x);
+		add(body.hitbox.center.y);
+	}
+
+	add(m_ammoCrates.size());
+	add(m_keys.size());
+
+	return hash;
+}
+
+
+//-----------------------------------------------------------------------------
+// Sorts walls, transition boxes and pickups into the level grid, pickup
+// bounds are gathered in scratch memory that is only needed while building
+//-----------------------------------------------------------------------------
+void Game::BuildLevelGrid(std::pmr::memory_resource* scratch)
+{
+	PROFILE_ZONE("Game::BuildLevelGrid");
+
+	std::pmr::vector<Rect> transitionBounds(scratch);
+	transitionBounds.reserve(m_transitions.size());
+	for (const GameObjects::TransitionBox& box : m_transitions)
+		transitionBounds.push_back(box.bounds);
+
+	std::pmr::vector<Rect> ammoCrateBounds(scratch);
+	ammoCrateBounds.reserve(m_ammoCrates.size());
+	for (const GameObjects::AmmoCrate& ammoCrate : m_ammoCrates)
+		ammoCrateBounds.push_back(ammoCrate.bounds);
+
+	std::pmr::vector<Rect> keyBounds(scratch);
+	keyBounds.reserve(m_keys.size());
+	for (const GameObjects::Key& key : m_keys)
+		keyBounds.push_back(key.bounds);
+
+	m_levelGrid.Build({ m_environment, transitionBounds, ammoCrateBounds, keyBounds });
+}
+
+
+//-----------------------------------------------------------------------------
+// Rebuilds what the player can see, only if the player moved or a level
+// was loaded since the last build, shooting, enemy sight and the sectors
+// enemies check their sight in all use it
+// Called once per frame and before a shot, so pellets start at the player
+//-----------------------------------------------------------------------------
+void Game::UpdatePlayerSight()
+{
+	if (!m_playerSight.IsEmpty() && m_playerSight.GetOrigin() == m_player.GetOrigin()) return;
+
+	m_playerSight.Build(m_player.GetOrigin());
+	m_perceptionEvents.SetPlayerSight(m_playerSight);
+}
+
+
 //-----------------------------------------------------------------------------
 // First unloads current level then loads a new level from a json file in 
 // levels folder
 //-----------------------------------------------------------------------------
 void Game::LoadLevel(uint16_t nexLevelID)
 {
+	PROFILE_ZONE("Game::LoadLevel");
+	ScopedMetricTimer loadTimer(MetricCounter::LoadLevelMicroseconds);
+
 	using namespace rapidjson;
 
-	// Unloads current level
-	m_environment.clear();
-	m_ammoCrates.clear();
-	m_transitions.clear();
-	m_keys.clear();
-	m_enemies.clear();
+	m_currentLevelID = nexLevelID;
+
+	// Unloads current level, emptied lists give their memory back to the
+	// level arena, which then frees all of it at once
+	m_environment = std::pmr::vector<Rect>(&m_levelArena);
+	m_ammoCrates = std::pmr::vector<GameObjects::AmmoCrate>(&m_levelArena);
+	m_transitions = std::pmr::vector<GameObjects::TransitionBox>(&m_levelArena);
+	m_keys = std::pmr::vector<GameObjects::Key>(&m_levelArena);
+	m_enemies = EnemyStore(&m_levelArena);
+	m_levelGrid = StaticGrid(&m_levelArena);
+	m_enemyGrid = EnemyGrid(&m_levelArena);
+	m_playerSight = VisibilityPolygon(&m_levelArena);
+	m_flowField = FlowField(&m_levelArena);
+	m_perceptionScheduler = PerceptionScheduler(&m_levelArena);
+	m_perceptionEvents = PerceptionEvents(&m_levelArena);
+	m_levelArena.Reset();
 	for (uint8_t i = 0; i < TEXT_BUFFER_SIZE; i++)
 	{
 		m_text[i].ClearTexture();
@@ -287,31 +833,39 @@ void Game::LoadLevel(uint16_t nexLevelID)
 	if (!levelJSON)
 	{
 		std::cerr << "Could not open level file: " << filename << '\n';
-		LoadLevel(404);
+		LoadLevel(MISSING_LEVEL_ID);
 		return;
 	}
 
-	char* readBuffer = new char[65536];
+	// The parsed file is only needed until the level is built, so it lives
+	// in its own arena that is freed when this function returns
+	MemoryArena parseArena(m_PARSE_ARENA_SIZE);
+	ArenaJsonAllocator arenaAllocator(&parseArena);
+	JsonPoolAllocator poolAllocator(64 * 1024, &arenaAllocator);
+
+	char* readBuffer = static_cast<char*>(parseArena.allocate(65536));
 	FileReadStream is(levelJSON, readBuffer, 65536);
 
-	Document document;
+	JsonDocument document(&poolAllocator, 1024, &arenaAllocator);
 	document.ParseStream(is);
 	fclose(levelJSON);
 
-	delete[] readBuffer;
-
 	if (!document.IsObject())
 	{
 		std::cout << "Invalid JSON format in " << filename << '\n';
-		LoadLevel(404);
+		LoadLevel(MISSING_LEVEL_ID);
 		return;
 	}
 
+	if (nexLevelID != GAME_OVER_LEVEL_ID && nexLevelID != MISSING_LEVEL_ID)
+		m_lastPlayableLevelID = nexLevelID;
+
 	// Access walls
-	const Value& walls = document["walls"];
+	const JsonValue& walls = document["walls"];
+	m_environment.reserve(walls.Size());
 	for (size_t i = 0; i < walls.Size(); i++)
 	{
-		const Value& wall = walls[i];
+		const JsonValue& wall = walls[i];
 		int x = wall["x"].GetInt();
 		int y = wall["y"].GetInt();
 		int width = wall["width"].GetInt();
@@ -321,12 +875,13 @@ void Game::LoadLevel(uint16_t nexLevelID)
 	}
 
 	// Access enemies
-	const Value& enemies = document["enemies"];
+	const JsonValue& enemies = document["enemies"];
+	m_enemies.Reserve(enemies.Size());
 	for (size_t i = 0; i < enemies.Size(); i++)
 	{
-		const Value& enemy = enemies[i];
-		uint16_t ID = enemy["ID"].GetUint();
-		if (m_unlockedGameObjects.test(65536 * static_cast<int>(GameObjects::GameObjectsEnum::Enemies) + ID)) continue;
+		const JsonValue& enemy = enemies[i];
+		uint32_t ID = enemy["ID"].GetUint();
+		if (m_worldState.Contains(nexLevelID, GameObjects::GameObjectsEnum::Enemies, ID)) continue;
 
 		std::string type = enemy["type"].GetString();
 		int pathStartX = enemy["pathStartX"].GetInt();
@@ -336,16 +891,23 @@ void Game::LoadLevel(uint16_t nexLevelID)
 
 		const LineSegment path(Vec2(pathStartX, pathStartY), Vec2(pathEndX, pathEndY));
 
-		m_enemies.emplace_back(Enemy::enemyMap.at(type), path, ID, this);
+		Enemies::Spawn(m_enemies, Enemies::enemyMap.at(type), path, ID, &m_levelArena);
 	}
 
+	// Reserved up front so rebuilding the grid and scheduling sight every
+	// step never allocates
+	m_enemyGrid.Reserve(m_enemies.Size());
+	m_perceptionScheduler.Reserve(m_enemies.Size());
+	m_enemyGrid.Build(m_enemies.Get<EnemyBody>());
+
 	// Access ammoCrates
-	const Value& ammoCrates = document["ammoCrates"];
+	const JsonValue& ammoCrates = document["ammoCrates"];
+	m_ammoCrates.reserve(ammoCrates.Size());
 	for (size_t i = 0; i < ammoCrates.Size(); i++)
 	{
-		const Value& ammoCrate = ammoCrates[i];
-		uint16_t ID = ammoCrate["ID"].GetUint();
-		if (m_unlockedGameObjects.test(65536 * static_cast<int>(GameObjects::GameObjectsEnum::AmmoCrates) + ID)) continue;
+		const JsonValue& ammoCrate = ammoCrates[i];
+		uint32_t ID = ammoCrate["ID"].GetUint();
+		if (m_worldState.Contains(nexLevelID, GameObjects::GameObjectsEnum::AmmoCrates, ID)) continue;
 
 		int x = ammoCrate["x"].GetInt();
 		int y = ammoCrate["y"].GetInt();
@@ -355,12 +917,13 @@ void Game::LoadLevel(uint16_t nexLevelID)
 	}
 
 	// Access keys
-	const Value& keys = document["keys"];
+	const JsonValue& keys = document["keys"];
+	m_keys.reserve(keys.Size());
 	for (size_t i = 0; i < keys.Size(); i++)
 	{
-		const Value& key = keys[i];
-		uint16_t ID = key["ID"].GetUint();
-		if (m_unlockedGameObjects.test(65536 * static_cast<int>(GameObjects::GameObjectsEnum::Keys) + ID)) continue;
+		const JsonValue& key = keys[i];
+		uint32_t ID = key["ID"].GetUint();
+		if (m_worldState.Contains(nexLevelID, GameObjects::GameObjectsEnum::Keys, ID)) continue;
 
 		int x = key["x"].GetInt();
 		int y = key["y"].GetInt();
@@ -369,10 +932,11 @@ void Game::LoadLevel(uint16_t nexLevelID)
 	}
 
 	// Access transition boxes
-	const Value& transitionBoxes = document["transitionBoxes"];
+	const JsonValue& transitionBoxes = document["transitionBoxes"];
+	m_transitions.reserve(transitionBoxes.Size());
 	for (size_t i = 0; i < transitionBoxes.Size(); i++)
 	{
-		const Value& transitionBox = transitionBoxes[i];
+		const JsonValue& transitionBox = transitionBoxes[i];
 
 		int x = transitionBox["x"].GetInt();
 		int y = transitionBox["y"].GetInt();
@@ -380,13 +944,19 @@ void Game::LoadLevel(uint16_t nexLevelID)
 		int height = transitionBox["height"].GetInt();
 
 		uint16_t nextLevelID = transitionBox["nextLevelID"].GetUint();
-		uint16_t keyID = transitionBox["keyID"].GetUint();
+		uint32_t keyID = transitionBox["keyID"].GetUint();
 
 		m_transitions.emplace_back(Vec2(x, y), width, height, nextLevelID, keyID);
 	}
 
+	// Builds the grid the player's overlap checks use, in the same order as the lists
+	BuildLevelGrid(&parseArena);
+	m_playerSight.SetWalls(m_environment, m_levelGrid);
+	m_flowField.Build(m_environment);
+	m_perceptionEvents.Build(m_environment);
+
 	// Access text
-	const Value& texts = document["texts"];
+	const JsonValue& texts = document["texts"];
 	if (texts.Size() > TEXT_BUFFER_SIZE)
 	{
 		std::cerr << "There can max be 10 text elements at once, and level has: " << texts.Size() << '\n';
@@ -394,7 +964,7 @@ void Game::LoadLevel(uint16_t nexLevelID)
 	}
 	for (size_t i = 0; i < texts.Size(); i++)
 	{
-		const Value& text = texts[i];
+		const JsonValue& text = texts[i];
 
 		const char* content = text["content"].GetString();
 		size_t length = text["content"].GetStringLength();
@@ -1,5 +1,6 @@
 #include "GameObjects.h"
 #include "RendererManager.h"
+#include "Metrics.h"
 
 using namespace Primitives2D;
 
@@ -83,6 +84,7 @@ namespace GameObjects
         };
 
         // Attempts to render texture
+        Metrics::GetInstance().Add(MetricCounter::DrawCalls);
         if (!SDL_RenderTexture(renderer, s_textures[static_cast<int>(type)].texture, NULL, &renderQuad))
         {
             std::cerr << "Unable to render key texture! Error: " << SDL_GetError() << '\n';
@@ -94,8 +96,8 @@ namespace GameObjects
     // Ammo crate constructor, ammoCount is amount of ammo player will recive
     // upon pickup
     //-----------------------------------------------------------------------------
-    AmmoCrate::AmmoCrate(const Vec2& position, uint8_t ammoCount, uint16_t ID)
-        : Rect(position, 42, 32)
+    AmmoCrate::AmmoCrate(const Vec2& position, uint8_t ammoCount, uint32_t ID)
+        : bounds(position, 42, 32)
         , ammoCount(ammoCount)
         , ID(ID)
     {}
@@ -105,8 +107,8 @@ namespace GameObjects
     // Key constructor, ID used both for checking when loading level as well as 
     // for unlocking locked transition boxes
     //-----------------------------------------------------------------------------
-    Key::Key(const Vec2& position, uint16_t ID)
-        : Rect(position, 32, 32)
+    Key::Key(const Vec2& position, uint32_t ID)
+        : bounds(position, 32, 32)
         , ID(ID)
     {}
 
@@ -115,8 +117,8 @@ namespace GameObjects
     // Transition box constructor, nextLevelID is level that will be loaded when 
     // player collides with box, keyID is which key unlock transition box
     //-----------------------------------------------------------------------------
-    TransitionBox::TransitionBox(const Vec2& position, float width, float height, uint16_t nextLevelID, uint16_t keyID)
-        : Rect(position, width, height)
+    TransitionBox::TransitionBox(const Vec2& position, float width, float height, uint16_t nextLevelID, uint32_t keyID)
+        : bounds(position, width, height)
         , nextLevelID(nextLevelID)
         , keyID(keyID)
     {}
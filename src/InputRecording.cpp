@@ -0,0 +1,137 @@
+#include "InputRecording.h"
+#include <cstdio>
+#include <iostream>
+
+namespace
+{
+    //-----------------------------------------------------------------------------
+    // Writes/reads a single value, fields are written one at a time so
+    // struct padding never ends up in the file
+    //-----------------------------------------------------------------------------
+    template <typename T>
+    bool Write(FILE* file, const T& value) { return fwrite(&value, sizeof(T), 1, file) == 1; }
+
+    template <typename T>
+    bool Read(FILE* file, T& value) { return fread(&value, sizeof(T), 1, file) == 1; }
+}
+
+
+//-----------------------------------------------------------------------------
+// Writes recording to a binary file
+//-----------------------------------------------------------------------------
+bool InputRecording::Save(const char* filepath) const
+{
+    FILE* file = fopen(filepath, "wb");
+    if (file == nullptr)
+    {
+        std::cerr << "Failed to open " << filepath << " for writing recording!" << '\n';
+        return false;
+    }
+
+    bool ok = Write(file, m_MAGIC) && Write(file, m_VERSION)
+        && Write(file, seed) && Write(file, startTime) && Write(file, startLevelID)
+        && Write(file, static_cast<uint32_t>(m_frames.size()));
+
+    for (size_t i = 0; ok && i < m_frames.size(); i++)
+    {
+        const InputFrame& frame = m_frames[i];
+        ok = Write(file, frame.timestamp)
+            && Write(file, frame.mousePos.x) && Write(file, frame.mousePos.y)
+            && Write(file, frame.shootPos.x) && Write(file, frame.shootPos.y)
+            && Write(file, frame.buttons)
+            && Write(file, static_cast<uint8_t>(frame.shoot)) && Write(file, static_cast<uint8_t>(frame.quit))
+            && Write(file, m_checksums[i]);
+    }
+
+    fclose(file);
+
+    if (!ok)
+    {
+        std::cerr << "Failed to write recording to " << filepath << '\n';
+        return false;
+    }
+
+    std::cout << "Saved " << m_frames.size() << " frames to " << filepath << '\n';
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Reads a recording written by Save()
+//-----------------------------------------------------------------------------
+bool InputRecording::Load(const char* filepath)
+{
+    Clear();
+
+    FILE* file = fopen(filepath, "rb");
+    if (file == nullptr)
+    {
+        std::cerr << "Failed to open recording " << filepath << '\n';
+        return false;
+    }
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t frameCount = 0;
+    bool ok = Read(file, magic) && Read(file, version)
+        && Read(file, seed) && Read(file, startTime) && Read(file, startLevelID)
+        && Read(file, frameCount);
+
+    if (!ok || magic != m_MAGIC || version != m_VERSION)
+    {
+        std::cerr << filepath << " is not a supported recording!" << '\n';
+        fclose(file);
+        return false;
+    }
+
+    m_frames.resize(frameCount);
+    m_checksums.resize(frameCount);
+
+    for (uint32_t i = 0; ok && i < frameCount; i++)
+    {
+        InputFrame& frame = m_frames[i];
+        uint8_t shoot = 0;
+        uint8_t quit = 0;
+
+        ok = Read(file, frame.timestamp)
+            && Read(file, frame.mousePos.x) && Read(file, frame.mousePos.y)
+            && Read(file, frame.shootPos.x) && Read(file, frame.shootPos.y)
+            && Read(file, frame.buttons)
+            && Read(file, shoot) && Read(file, quit)
+            && Read(file, m_checksums[i]);
+
+        frame.shoot = shoot != 0;
+        frame.quit = quit != 0;
+    }
+
+    fclose(file);
+
+    if (!ok)
+    {
+        std::cerr << "Recording " << filepath << " is truncated!" << '\n';
+        Clear();
+        return false;
+    }
+
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Adds a frame and the checksum of the game state after it
+//-----------------------------------------------------------------------------
+void InputRecording::AddFrame(const InputFrame& input, uint64_t checksum)
+{
+    m_frames.push_back(input);
+    m_checksums.push_back(checksum);
+}
+
+
+//-----------------------------------------------------------------------------
+// Removes all frames
+//-----------------------------------------------------------------------------
+void InputRecording::Clear()
+{
+    m_frames.clear();
+    m_checksums.clear();
+}
@@ -0,0 +1,264 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+// Index of the calling threads deque, -1 for threads outside the job system
+static thread_local int s_workerIndex = -1;
+
+//-----------------------------------------------------------------------------
+// Pushes a job onto the bottom of the deque, only called by the owning
+// worker, returns false if the deque is full
+//-----------------------------------------------------------------------------
+bool WorkStealingDeque::Push(Job* job)
+{
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    int64_t top = m_top.load(std::memory_order_acquire);
+    if (bottom - top >= CAPACITY) return false;
+
+    // Release makes the job visible to stealers that see the new bottom
+    m_jobs[bottom & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+    m_bottom.store(bottom + 1, std::memory_order_release);
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Pops the newest job from the bottom of the deque, only called by the
+// owning worker, races stealers for the last job
+//-----------------------------------------------------------------------------
+Job* WorkStealingDeque::Pop()
+{
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = m_top.load(std::memory_order_relaxed);
+
+    // Deque was empty
+    if (top > bottom)
+    {
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = m_jobs[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+
+    // Last job left, a stealer might be trying to take it aswell
+    if (top == bottom)
+    {
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = nullptr;
+
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+
+//-----------------------------------------------------------------------------
+// Steals the oldest job from the top of the deque, called by other workers,
+// returns nullptr if the deque is empty or another thread won the race
+//-----------------------------------------------------------------------------
+Job* WorkStealingDeque::Steal()
+{
+    int64_t top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom) return nullptr;
+
+    Job* job = m_jobs[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+
+    return job;
+}
+
+
+//-----------------------------------------------------------------------------
+// Returns reference to singelton instance
+//-----------------------------------------------------------------------------
+JobSystem& JobSystem::GetInstance()
+{
+    static JobSystem instance;
+    return instance;
+}
+
+
+//-----------------------------------------------------------------------------
+// Starts workerCount worker threads, the calling thread becomes worker 0
+// and helps out whenever it waits for a ParallelFor to finish
+// workerCount < 0 uses one worker per hardware thread except the callers
+//-----------------------------------------------------------------------------
+void JobSystem::Init(int workerCount)
+{
+    if (m_isRunning) return;
+
+    if (workerCount < 0)
+        workerCount = std::max(0, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+
+    for (int i = 0; i < workerCount + 1; i++)
+    {
+        m_deques.push_back(new WorkStealingDeque());
+    }
+
+    s_workerIndex = 0;
+    m_isRunning = true;
+
+    for (int i = 1; i < workerCount + 1; i++)
+    {
+        m_workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Stops and joins all worker threads, call from the same thread as Init()
+//-----------------------------------------------------------------------------
+void JobSystem::Destroy()
+{
+    if (!m_isRunning) return;
+
+    // Wakes up sleeping workers so they can see that they should exit
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_isRunning = false;
+    }
+    m_wakeCondition.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+
+    for (WorkStealingDeque* deque : m_deques)
+    {
+        delete deque;
+    }
+    m_deques.clear();
+
+    s_workerIndex = -1;
+}
+
+
+//-----------------------------------------------------------------------------
+// True if the calling thread can split work across other workers
+//-----------------------------------------------------------------------------
+bool JobSystem::CanSplit() const
+{
+    return m_isRunning.load(std::memory_order_relaxed) && s_workerIndex >= 0 && m_deques.size() > 1;
+}
+
+
+//-----------------------------------------------------------------------------
+// Splits [0, count) into batches, pushes all but the first onto the calling
+// workers deque for others to steal, runs the first itself and then keeps
+// executing jobs until every batch is done
+//-----------------------------------------------------------------------------
+void JobSystem::Fork(size_t count, size_t minBatchSize, void (*function)(const void*, size_t, size_t), const void* data)
+{
+    // A few batches per thread, so threads that finish early can steal more
+    size_t maxBatches = std::min(MAX_BATCHES, m_deques.size() * 4);
+    size_t batchCount = std::min((count + minBatchSize - 1) / minBatchSize, maxBatches);
+    size_t batchSize = (count + batchCount - 1) / batchCount;
+    batchCount = (count + batchSize - 1) / batchSize;
+
+    Job jobs[MAX_BATCHES];
+    std::atomic<int> pendingJobs(static_cast<int>(batchCount));
+    WorkStealingDeque* deque = m_deques[s_workerIndex];
+
+    for (size_t i = 0; i < batchCount; i++)
+    {
+        jobs[i].function    = function;
+        jobs[i].data        = data;
+        jobs[i].begin       = i * batchSize;
+        jobs[i].end         = std::min(count, (i + 1) * batchSize);
+        jobs[i].pendingJobs = &pendingJobs;
+    }
+
+    // Pushes in reverse so the owner pops batches in order
+    int pushedJobs = 0;
+    for (size_t i = batchCount - 1; i > 0; i--)
+    {
+        // Runs inline if the deque is full
+        if (deque->Push(&jobs[i]))
+            pushedJobs++;
+        else
+            Execute(&jobs[i]);
+    }
+
+    // Wakes up sleeping workers
+    if (pushedJobs > 0)
+    {
+        m_queuedJobs.fetch_add(pushedJobs, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+        }
+        m_wakeCondition.notify_all();
+    }
+
+    Execute(&jobs[0]);
+
+    // Helps with any job while waiting, jobs array has to outlive every batch
+    while (pendingJobs.load(std::memory_order_acquire) > 0)
+    {
+        if (Job* job = FindJob(s_workerIndex))
+            Execute(job);
+        else
+            std::this_thread::yield();
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Worker threads run jobs until Destroy() is called, sleeps when there
+// is nothing to do
+//-----------------------------------------------------------------------------
+void JobSystem::WorkerLoop(int workerIndex)
+{
+    s_workerIndex = workerIndex;
+
+    while (m_isRunning.load(std::memory_order_acquire))
+    {
+        if (Job* job = FindJob(workerIndex))
+        {
+            Execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wakeCondition.wait(lock, [this]() {
+            return m_queuedJobs.load(std::memory_order_acquire) > 0 || !m_isRunning.load(std::memory_order_acquire);
+        });
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Takes a job from the workers own deque, otherwise steals from the others
+//-----------------------------------------------------------------------------
+Job* JobSystem::FindJob(int workerIndex)
+{
+    Job* job = m_deques[workerIndex]->Pop();
+
+    // Starts stealing from the next worker so victims are spread out
+    size_t dequeCount = m_deques.size();
+    for (size_t i = 1; i < dequeCount && !job; i++)
+    {
+        job = m_deques[(workerIndex + i) % dequeCount]->Steal();
+    }
+
+    if (job) m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    return job;
+}
+
+
+//-----------------------------------------------------------------------------
+// Runs a job and signals that it is done, job must not be touched after
+// since its owner might return right away
+//-----------------------------------------------------------------------------
+void JobSystem::Execute(Job* job)
+{
+    job->function(job->data, job->begin, job->end);
+    job->pendingJobs->fetch_sub(1, std::memory_order_release);
+}
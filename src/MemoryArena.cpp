@@ -0,0 +1,102 @@
+#include "MemoryArena.h"
+#include <algorithm>
+#include <memory>
+#include <new>
+
+//-----------------------------------------------------------------------------
+// Constructor, allocates the first block up front
+//-----------------------------------------------------------------------------
+MemoryArena::MemoryArena(size_t initialCapacity)
+{
+    AddBlock(initialCapacity);
+}
+
+
+//-----------------------------------------------------------------------------
+// Destructor, frees every block
+//-----------------------------------------------------------------------------
+MemoryArena::~MemoryArena()
+{
+    FreeBlocks();
+}
+
+
+//-----------------------------------------------------------------------------
+// Frees everything at once, if the last use needed more than one block
+// they are replaced by a single block big enough for all of it, so the
+// arena stops going to the heap once it has seen its peak usage
+//-----------------------------------------------------------------------------
+void MemoryArena::Reset()
+{
+    m_usedBytes = 0;
+
+    if (m_currentBlock->previous != nullptr)
+    {
+        size_t capacity = m_capacity;
+        FreeBlocks();
+        AddBlock(capacity);
+        return;
+    }
+
+    m_cursor = reinterpret_cast<std::byte*>(m_currentBlock + 1);
+}
+
+
+//-----------------------------------------------------------------------------
+// Bumps the cursor of the current block, starts a new block at least as
+// big as the whole arena when it doesn't fit
+//-----------------------------------------------------------------------------
+void* MemoryArena::do_allocate(size_t bytes, size_t alignment)
+{
+    size_t space = static_cast<size_t>(m_end - m_cursor);
+    void* pointer = m_cursor;
+
+    if (std::align(alignment, bytes, pointer, space) == nullptr)
+    {
+        AddBlock(std::max(bytes + alignment, m_capacity));
+
+        space = static_cast<size_t>(m_end - m_cursor);
+        pointer = m_cursor;
+        std::align(alignment, bytes, pointer, space);
+    }
+
+    m_cursor = static_cast<std::byte*>(pointer) + bytes;
+    m_usedBytes += bytes;
+    return pointer;
+}
+
+
+//-----------------------------------------------------------------------------
+// Allocates a block with room for size bytes after its header
+//-----------------------------------------------------------------------------
+void MemoryArena::AddBlock(size_t size)
+{
+    Block* block = static_cast<Block*>(::operator new(sizeof(Block) + size));
+    block->previous = m_currentBlock;
+    block->size = size;
+
+    m_currentBlock = block;
+    m_cursor = reinterpret_cast<std::byte*>(block + 1);
+    m_end = m_cursor + size;
+
+    m_capacity += size;
+    m_blockAllocations++;
+}
+
+
+//-----------------------------------------------------------------------------
+// Frees every block, the arena is unusable until AddBlock is called
+//-----------------------------------------------------------------------------
+void MemoryArena::FreeBlocks()
+{
+    while (m_currentBlock != nullptr)
+    {
+        Block* previous = m_currentBlock->previous;
+        ::operator delete(m_currentBlock);
+        m_currentBlock = previous;
+    }
+
+    m_cursor = nullptr;
+    m_end = nullptr;
+    m_capacity = 0;
+}
@@ -0,0 +1,252 @@
+#include "Metrics.h"
+#include <iostream>
+
+// Counters of the calling thread, registered the first time it adds to one
+static thread_local ThreadCounters* s_threadCounters = nullptr;
+
+namespace
+{
+    // Column names, in the same order as the enums
+    const char* const COUNTER_NAMES[METRIC_COUNTER_COUNT] = {
+        "rays_cast",
+        "rect_tests",
+        "sight_checks",
+        "text_textures_created",
+        "audio_plays",
+        "draw_calls",
+        "load_level_us",
+        "heap_allocations",
+        "simulation_steps",
+        "flow_field_updates",
+        "perception_deferred"
+    };
+
+    const char* const GAUGE_NAMES[METRIC_GAUGE_COUNT] = {
+        "frame_ms",
+        "events_ms",
+        "player_ms",
+        "enemies_ms",
+        "render_ms",
+        "enemies",
+        "shotgun_blasts",
+        "audio_voices",
+        "audio_load",
+        "level_arena_bytes"
+    };
+}
+
+
+//-----------------------------------------------------------------------------
+// Returns reference to singelton instance
+//-----------------------------------------------------------------------------
+Metrics& Metrics::GetInstance()
+{
+    static Metrics instance;
+    return instance;
+}
+
+
+//-----------------------------------------------------------------------------
+// Constructor, frame times are relative to when metrics were created
+//-----------------------------------------------------------------------------
+Metrics::Metrics()
+    : m_startTime(std::chrono::steady_clock::now())
+{}
+
+
+//-----------------------------------------------------------------------------
+// Destructor, stops writer thread and frees every threads counters
+//-----------------------------------------------------------------------------
+Metrics::~Metrics()
+{
+    StopWriting();
+
+    uint32_t threadCount = m_threadCount.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        delete m_threadCounters[i];
+        m_threadCounters[i] = nullptr;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Adds to a counter, safe to call from any thread
+//-----------------------------------------------------------------------------
+void Metrics::Add(MetricCounter counter, uint64_t amount)
+{
+    ThreadCounters* counters = GetThreadCounters();
+    std::atomic<uint64_t>& value = counters->values[static_cast<int>(counter)];
+
+    // Only the owning thread writes its counters, so a plain load and store is enough
+    if (counters != &m_overflowCounters)
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    else
+        value.fetch_add(amount, std::memory_order_relaxed);
+}
+
+
+//-----------------------------------------------------------------------------
+// Returns the calling threads counters, registers them the first time
+//-----------------------------------------------------------------------------
+ThreadCounters* Metrics::GetThreadCounters()
+{
+    if (s_threadCounters) return s_threadCounters;
+
+    std::lock_guard<std::mutex> lock(m_registerMutex);
+
+    uint32_t index = m_threadCount.load(std::memory_order_relaxed);
+    if (index >= MAX_THREADS)
+    {
+        s_threadCounters = &m_overflowCounters;
+        return s_threadCounters;
+    }
+
+    m_threadCounters[index] = new ThreadCounters();
+    m_threadCount.store(index + 1, std::memory_order_release);
+
+    s_threadCounters = m_threadCounters[index];
+    return s_threadCounters;
+}
+
+
+//-----------------------------------------------------------------------------
+// Called by the main thread once per frame, turns running totals into
+// this frames counts and queues the frame for writing
+//-----------------------------------------------------------------------------
+void Metrics::EndFrame()
+{
+    uint64_t totals[METRIC_COUNTER_COUNT] = {};
+
+    uint32_t threadCount = m_threadCount.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        for (int j = 0; j < METRIC_COUNTER_COUNT; j++)
+            totals[j] += m_threadCounters[i]->values[j].load(std::memory_order_relaxed);
+    }
+    for (int j = 0; j < METRIC_COUNTER_COUNT; j++)
+        totals[j] += m_overflowCounters.values[j].load(std::memory_order_relaxed);
+
+    MetricsFrame frame;
+    frame.frame = m_lastFrame.frame + 1;
+    frame.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_startTime).count();
+
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++)
+    {
+        frame.counters[i] = totals[i] - m_previousTotals[i];
+        m_previousTotals[i] = totals[i];
+    }
+    for (int i = 0; i < METRIC_GAUGE_COUNT; i++)
+        frame.gauges[i] = m_gauges[i];
+
+    m_lastFrame = frame;
+
+    if (m_isWriting.load(std::memory_order_relaxed) && !m_writeQueue.Push(frame))
+        m_droppedFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+//-----------------------------------------------------------------------------
+// Opens a CSV file and starts the thread writing frames to it
+//-----------------------------------------------------------------------------
+bool Metrics::StartWriting(const char* filepath)
+{
+    if (m_isWriting) StopWriting();
+
+    m_file = fopen(filepath, "w");
+    if (m_file == nullptr)
+    {
+        std::cerr << "Failed to open " << filepath << " for writing metrics!" << '\n';
+        return false;
+    }
+
+    // Header row
+    fprintf(m_file, "frame,time_s");
+    for (const char* name : COUNTER_NAMES) fprintf(m_file, ",%s", name);
+    for (const char* name : GAUGE_NAMES) fprintf(m_file, ",%s", name);
+    fprintf(m_file, "\n");
+
+    m_isWriting = true;
+    m_writerThread = std::thread(&Metrics::WriterLoop, this);
+
+    std::cout << "Writing metrics to " << filepath << '\n';
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Writes every queued frame and stops the writer thread
+//-----------------------------------------------------------------------------
+void Metrics::StopWriting()
+{
+    if (!m_isWriting) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        m_isWriting = false;
+    }
+    m_writerCondition.notify_one();
+
+    if (m_writerThread.joinable()) m_writerThread.join();
+
+    fclose(m_file);
+    m_file = nullptr;
+
+    uint32_t dropped = m_droppedFrames.exchange(0);
+    if (dropped > 0)
+        std::cerr << "Metrics writer fell behind, " << dropped << " frames were not written!" << '\n';
+}
+
+
+//-----------------------------------------------------------------------------
+// Writer thread, wakes up every FLUSH_INTERVAL and writes what has been
+// queued since last time
+//-----------------------------------------------------------------------------
+void Metrics::WriterLoop()
+{
+    std::unique_lock<std::mutex> lock(m_writerMutex);
+    while (m_isWriting)
+    {
+        m_writerCondition.wait_for(lock, FLUSH_INTERVAL, [this] { return !m_isWriting; });
+
+        // Writing doesn't need the lock, only waiting does
+        lock.unlock();
+        WriteQueuedFrames();
+        lock.lock();
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Writes every queued frame as a CSV row, writer thread only
+//-----------------------------------------------------------------------------
+void Metrics::WriteQueuedFrames()
+{
+    MetricsFrame frame;
+    while (m_writeQueue.Pop(frame))
+    {
+        fprintf(m_file, "%llu,%.4f", static_cast<unsigned long long>(frame.frame), frame.time);
+        for (uint64_t value : frame.counters) fprintf(m_file, ",%llu", static_cast<unsigned long long>(value));
+        for (float value : frame.gauges) fprintf(m_file, ",%g", value);
+        fprintf(m_file, "\n");
+    }
+
+    fflush(m_file);
+}
+
+
+//-----------------------------------------------------------------------------
+// Returns the column name of a counter
+//-----------------------------------------------------------------------------
+const char* Metrics::GetName(MetricCounter counter)
+{
+    return COUNTER_NAMES[static_cast<int>(counter)];
+}
+
+//-----------------------------------------------------------------------------
+// Returns the column name of a gauge
+//-----------------------------------------------------------------------------
+const char* Metrics::GetName(MetricGauge gauge)
+{
+    return GAUGE_NAMES[static_cast<int>(gauge)];
+}
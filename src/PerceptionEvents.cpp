@@ -0,0 +1,198 @@
+#include "PerceptionEvents.h"
+#include "Profiler.h"
+#include <algorithm>
+
+using namespace Primitives2D;
+
+//-----------------------------------------------------------------------------
+// Sizes the sectors to fit every wall plus a border, sectors grow when the
+// level is too big for m_MAX_SECTORS, every sector is in sight until the
+// player's sight is set
+//-----------------------------------------------------------------------------
+void PerceptionEvents::Build(std::span<const Rect> walls)
+{
+    PROFILE_ZONE("PerceptionEvents::Build");
+
+    m_sectorSize = m_MIN_SECTOR_SIZE;
+    m_columns = 0;
+    m_rows = 0;
+    m_noises.clear();
+
+    if (!walls.empty())
+    {
+        Vec2 worldMin = walls[0].min;
+        Vec2 worldMax = walls[0].max;
+        for (const Rect& wall : walls)
+        {
+            worldMin = Vec2(std::min(worldMin.x, wall.min.x), std::min(worldMin.y, wall.min.y));
+            worldMax = Vec2(std::max(worldMax.x, wall.max.x), std::max(worldMax.y, wall.max.y));
+        }
+
+        const Vec2 size = worldMax - worldMin;
+        do
+        {
+            m_columns = static_cast<int>(size.x / m_sectorSize) + 1 + m_BORDER_SECTORS * 2;
+            m_rows = static_cast<int>(size.y / m_sectorSize) + 1 + m_BORDER_SECTORS * 2;
+            if (static_cast<size_t>(m_columns) * m_rows <= m_MAX_SECTORS) break;
+            m_sectorSize *= 2.0f;
+        } while (true);
+
+        m_origin = worldMin - Vec2(m_BORDER_SECTORS * m_sectorSize, m_BORDER_SECTORS * m_sectorSize);
+    }
+
+    m_visibleSectors.assign(static_cast<size_t>(m_columns) * m_rows, 1);
+}
+
+
+//-----------------------------------------------------------------------------
+// Everything between two neighbouring outline points is at most as far
+// away as the further of them, so each angle bucket gets the furthest reach
+// of every outline edge it overlaps. A sector is in sight if any bucket its
+// corners span reaches its closest point
+//-----------------------------------------------------------------------------
+void PerceptionEvents::SetPlayerSight(const VisibilityPolygon& playerSight)
+{
+    PROFILE_ZONE("PerceptionEvents::SetPlayerSight");
+
+    const std::span<const Vec2> points = playerSight.GetPoints();
+    const std::span<const float> angles = playerSight.GetAngles();
+    const Vec2 sightOrigin = playerSight.GetOrigin();
+
+    // Sight without an outline treats everything as visible
+    if (points.size() < 2)
+    {
+        std::fill(m_visibleSectors.begin(), m_visibleSectors.end(), 1);
+        return;
+    }
+
+    std::fill(std::begin(m_bucketReach), std::end(m_bucketReach), 0.0f);
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        const size_t next = (i + 1) % points.size();
+        const float reach = std::max((points[i] - sightOrigin).Length(), (points[next] - sightOrigin).Length());
+
+        // The last edge wraps around from the largest angle to the smallest
+        if (next == 0)
+        {
+            SetReach(GetBucket(angles[i]), m_ANGLE_BUCKETS - 1, reach);
+            SetReach(0, GetBucket(angles[next]), reach);
+        }
+        else
+        {
+            SetReach(GetBucket(angles[i]), GetBucket(angles[next]), reach);
+        }
+    }
+
+    for (int row = 0; row < m_rows; row++)
+    {
+        for (int column = 0; column < m_columns; column++)
+        {
+            m_visibleSectors[row * m_columns + column] = IsSectorInReach(column, row, sightOrigin);
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Looks up the sector position is in
+//-----------------------------------------------------------------------------
+bool PerceptionEvents::IsInPlayerSight(const Vec2& position) const
+{
+    const float column = std::floor((position.x - m_origin.x) / m_sectorSize);
+    const float row = std::floor((position.y - m_origin.y) / m_sectorSize);
+    if (column < 0.0f || column >= m_columns || row < 0.0f || row >= m_rows) return true;
+
+    return m_visibleSectors[static_cast<int>(row) * m_columns + static_cast<int>(column)];
+}
+
+
+//-----------------------------------------------------------------------------
+// Every enemy within m_SHOT_NOISE_RADIUS of position hears the shot the
+// next time enemies update
+//-----------------------------------------------------------------------------
+void PerceptionEvents::PublishShot(const Vec2& position)
+{
+    m_noises.emplace_back(position, m_SHOT_NOISE_RADIUS);
+}
+
+
+//-----------------------------------------------------------------------------
+// Gets the bucket of an angle between -PI and PI
+//-----------------------------------------------------------------------------
+int PerceptionEvents::GetBucket(float angle)
+{
+    const int bucket = static_cast<int>((angle + PI) / (2.0f * PI) * m_ANGLE_BUCKETS);
+    return std::clamp(bucket, 0, m_ANGLE_BUCKETS - 1);
+}
+
+
+//-----------------------------------------------------------------------------
+// Raises the reach of every bucket from firstBucket to lastBucket
+//-----------------------------------------------------------------------------
+void PerceptionEvents::SetReach(int firstBucket, int lastBucket, float reach)
+{
+    for (int bucket = firstBucket; bucket <= lastBucket; bucket++)
+    {
+        m_bucketReach[bucket] = std::max(m_bucketReach[bucket], reach);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Angles of a sector's corners are measured from the angle of its center,
+// so sectors straddling the angle where atan2 wraps get the right range
+// Sectors sightOrigin is in are always in reach
+//-----------------------------------------------------------------------------
+bool PerceptionEvents::IsSectorInReach(int column, int row, const Vec2& sightOrigin) const
+{
+    const Vec2 sectorMin = m_origin + Vec2(column * m_sectorSize, row * m_sectorSize);
+    const Vec2 sectorMax = sectorMin + Vec2(m_sectorSize, m_sectorSize);
+
+    const Vec2 closest(std::clamp(sightOrigin.x, sectorMin.x, sectorMax.x), std::clamp(sightOrigin.y, sectorMin.y, sectorMax.y));
+    const float distance = (closest - sightOrigin).Length();
+    if (distance < 0.001f) return true;
+
+    const Vec2 toCenter = (sectorMin + sectorMax) * 0.5f - sightOrigin;
+    const float centerAngle = atan2(toCenter.y, toCenter.x);
+    float minOffset = 0.0f;
+    float maxOffset = 0.0f;
+    for (const Vec2& corner : { sectorMin, sectorMax, Vec2(sectorMin.x, sectorMax.y), Vec2(sectorMax.x, sectorMin.y) })
+    {
+        const Vec2 toCorner = corner - sightOrigin;
+        float offset = atan2(toCorner.y, toCorner.x) - centerAngle;
+        if (offset > PI) offset -= 2.0f * PI;
+        if (offset < -PI) offset += 2.0f * PI;
+
+        minOffset = std::min(minOffset, offset);
+        maxOffset = std::max(maxOffset, offset);
+    }
+
+    // Splits ranges that wrap around into two
+    float firstAngle = centerAngle + minOffset;
+    float lastAngle = centerAngle + maxOffset;
+    int ranges[2][2] = { { 0, -1 }, { 0, -1 } };
+    if (firstAngle < -PI)
+    {
+        ranges[0][0] = GetBucket(firstAngle + 2.0f * PI);
+        ranges[0][1] = m_ANGLE_BUCKETS - 1;
+        firstAngle = -PI;
+    }
+    else if (lastAngle > PI)
+    {
+        ranges[0][0] = 0;
+        ranges[0][1] = GetBucket(lastAngle - 2.0f * PI);
+        lastAngle = PI;
+    }
+    ranges[1][0] = GetBucket(firstAngle);
+    ranges[1][1] = GetBucket(lastAngle);
+
+    for (const auto& range : ranges)
+    {
+        for (int bucket = range[0]; bucket <= range[1]; bucket++)
+        {
+            if (m_bucketReach[bucket] >= distance) return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,75 @@
+#include "PerceptionScheduler.h"
+#include "Enemy.h"
+#include "Profiler.h"
+#include "Metrics.h"
+#include <algorithm>
+
+using namespace Primitives2D;
+
+//-----------------------------------------------------------------------------
+// Enemies near the player look 60 times a second, far ones 20 times, idle
+// enemies half as often since they only stand still
+//-----------------------------------------------------------------------------
+uint16_t PerceptionScheduler::GetSightInterval(EnemyStates state, float distanceToPlayer)
+{
+    if (state == EnemyStates::Chasing) return 1;
+
+    const uint16_t interval = distanceToPlayer < m_NEAR_DISTANCE ? 2 : 6;
+    return state == EnemyStates::Idle ? interval * 2 : interval;
+}
+
+
+//-----------------------------------------------------------------------------
+// Reserves the scheduling lists
+//-----------------------------------------------------------------------------
+void PerceptionScheduler::Reserve(size_t enemyCount)
+{
+    m_entries.reserve(enemyCount);
+    m_due.reserve(enemyCount);
+}
+
+
+//-----------------------------------------------------------------------------
+// Collects the enemies whose sight mesh is due and sorts them by priority,
+// enemies that were deferred before always go first so none of them waits
+// forever
+//-----------------------------------------------------------------------------
+std::span<const uint32_t> PerceptionScheduler::ScheduleMeshes(std::span<const EnemyBody> bodies, std::span<const EnemyPerception> perceptions, const Vec2& playerPos)
+{
+    PROFILE_ZONE("PerceptionScheduler::ScheduleMeshes");
+
+    m_entries.clear();
+    m_due.clear();
+
+    for (uint32_t i = 0; i < bodies.size(); i++)
+    {
+        if (!perceptions[i].isMeshDue) continue;
+
+        const uint32_t notWaited = UINT16_MAX - perceptions[i].meshStepsWaited;
+        const uint32_t distance = static_cast<uint32_t>((bodies[i].hitbox.center - playerPos).Length());
+        m_entries.push_back({ static_cast<uint64_t>(notWaited) << 32 | distance, i });
+    }
+
+    std::sort(m_entries.begin(), m_entries.end(), [](const Entry& a, const Entry& b) { return a.key < b.key; });
+
+    for (const Entry& entry : m_entries)
+    {
+        m_due.push_back(entry.index);
+    }
+
+    return m_due;
+}
+
+
+//-----------------------------------------------------------------------------
+// Deferred meshes stay due and move up in the next step's order
+//-----------------------------------------------------------------------------
+void PerceptionScheduler::Defer(std::span<const uint32_t> indices, std::span<EnemyPerception> perceptions)
+{
+    Metrics::GetInstance().Add(MetricCounter::PerceptionDeferred, indices.size());
+
+    for (uint32_t i : indices)
+    {
+        if (perceptions[i].meshStepsWaited < UINT16_MAX) perceptions[i].meshStepsWaited++;
+    }
+}
@@ -0,0 +1,133 @@
+#include "PerfOverlay.h"
+#include "Settings.h"
+#include "RendererManager.h"
+#include "AudioManager.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cstdio>
+
+//-----------------------------------------------------------------------------
+// Constructor, places overlay in the top right corner of the screen
+//-----------------------------------------------------------------------------
+PerfOverlay::PerfOverlay()
+    : m_position(Settings::WINDOW_WIDTH - m_GRAPH_WIDTH - 10.0f, 10.0f)
+{}
+
+
+//-----------------------------------------------------------------------------
+// Adds a frame to the frame time history, called every frame even when
+// hidden since it only writes to fixed size arrays
+//-----------------------------------------------------------------------------
+void PerfOverlay::AddFrame(const FrameTimings& timings)
+{
+    m_latest = timings;
+    m_frameTimes[m_historyIndex] = timings.frameMs;
+    m_historyIndex = (m_historyIndex + 1) % m_HISTORY_SIZE;
+}
+
+
+//-----------------------------------------------------------------------------
+// Rebuilds the graph every frame and the text a few times a second,
+// does nothing while hidden
+//-----------------------------------------------------------------------------
+void PerfOverlay::Update(float deltaTime)
+{
+    if (!m_isVisible) return;
+
+    RebuildGraph();
+
+    // Creating text textures is expensive, so don't do it every frame
+    m_refreshTimer -= deltaTime;
+    if (m_refreshTimer > 0.0f) return;
+
+    m_refreshTimer = m_REFRESH_TIME;
+    RebuildText();
+}
+
+
+//-----------------------------------------------------------------------------
+// Renders background, frame time graph and text
+//-----------------------------------------------------------------------------
+void PerfOverlay::Render() const
+{
+    if (!m_isVisible) return;
+
+    SDL_Renderer* renderer = RendererManager::GetInstance().GetRenderer();
+
+    // Background for both text and graph
+    const float textHeight = m_LINE_COUNT * 20.0f;
+    const SDL_FRect background = { m_position.x - 6.0f, m_position.y - 6.0f, m_GRAPH_WIDTH + 12.0f, textHeight + m_GRAPH_HEIGHT + 18.0f };
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 200);
+    SDL_RenderFillRect(renderer, &background);
+
+    // Reference lines for 60 and 30 fps
+    const float graphBottom = m_position.y + textHeight + m_GRAPH_HEIGHT;
+    const float targetMs[2] = { 1000.0f / 60.0f, 1000.0f / 30.0f };
+    SDL_SetRenderDrawColor(renderer, 80, 80, 80, 255);
+    for (float ms : targetMs)
+    {
+        float y = graphBottom - ms / m_GRAPH_MAX_MS * m_GRAPH_HEIGHT;
+        SDL_RenderLine(renderer, m_position.x, y, m_position.x + m_GRAPH_WIDTH, y);
+    }
+
+    // Frame time graph, oldest frame to the left
+    SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
+    SDL_RenderLines(renderer, m_graphPoints, m_HISTORY_SIZE);
+    Metrics::GetInstance().Add(MetricCounter::DrawCalls, 4);
+
+    for (const Text& line : m_lines)
+    {
+        if (!line.IsNull())
+            line.RenderTexture();
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Calculates graph points from frame time history
+//-----------------------------------------------------------------------------
+void PerfOverlay::RebuildGraph()
+{
+    const float textHeight = m_LINE_COUNT * 20.0f;
+    const float graphBottom = m_position.y + textHeight + m_GRAPH_HEIGHT;
+    const float step = m_GRAPH_WIDTH / (m_HISTORY_SIZE - 1);
+
+    for (int i = 0; i < m_HISTORY_SIZE; i++)
+    {
+        // m_historyIndex is the oldest frame
+        float ms = std::min(m_frameTimes[(m_historyIndex + i) % m_HISTORY_SIZE], m_GRAPH_MAX_MS);
+        m_graphPoints[i] = { m_position.x + i * step, graphBottom - ms / m_GRAPH_MAX_MS * m_GRAPH_HEIGHT };
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Calculates percentiles and recreates every line of text
+//-----------------------------------------------------------------------------
+void PerfOverlay::RebuildText()
+{
+    // Sorts a copy so the history keeps its order
+    float sorted[m_HISTORY_SIZE];
+    std::copy(m_frameTimes, m_frameTimes + m_HISTORY_SIZE, sorted);
+    std::nth_element(sorted, sorted + m_HISTORY_SIZE / 2, sorted + m_HISTORY_SIZE);
+    float p50 = sorted[m_HISTORY_SIZE / 2];
+    std::nth_element(sorted, sorted + m_HISTORY_SIZE * 99 / 100, sorted + m_HISTORY_SIZE);
+    float p99 = sorted[m_HISTORY_SIZE * 99 / 100];
+
+    const AudioMixer& mixer = AudioManager::GetInstance().GetMixer();
+
+    char buffer[m_LINE_COUNT][96];
+    snprintf(buffer[0], sizeof(buffer[0]), "frame %5.2fms  p50 %5.2fms  p99 %5.2fms", m_latest.frameMs, p50, p99);
+    snprintf(buffer[1], sizeof(buffer[1]), "events %.2f player %.2f enemies %.2f render %.2f",
+        m_latest.eventsMs, m_latest.playerMs, m_latest.enemiesMs, m_latest.renderMs);
+    snprintf(buffer[2], sizeof(buffer[2]), "rays %u  wall tests %u", m_latest.raysCast, m_latest.wallTests);
+    snprintf(buffer[3], sizeof(buffer[3]), "draw calls %u", m_latest.drawCalls);
+    snprintf(buffer[4], sizeof(buffer[4]), "enemies %u  shotgun blasts %u", m_latest.enemyCount, m_latest.blastCount);
+    snprintf(buffer[5], sizeof(buffer[5]), "audio load %.1f%%  voices %d/%d  dropped %u",
+        mixer.GetCallbackLoad() * 100.0f, mixer.GetActiveVoiceCount(), AudioMixer::MAX_VOICES, mixer.GetDroppedCount());
+
+    for (int i = 0; i < m_LINE_COUNT; i++)
+    {
+        m_lines[i].CreateTextTexture(buffer[i], strlen(buffer[i]), 16.0f, { 255, 255, 255, 255 }, Vec2(m_position.x, m_position.y + i * 20.0f));
+    }
+}
@@ -2,6 +2,8 @@
 #include "Game.h"
 #include "Settings.h"
 #include "AudioManager.h"
+#include "Profiler.h"
+#include "EntityStore.h"
 #include <algorithm>
 
 using namespace Primitives2D;
@@ -11,64 +13,75 @@ using namespace Primitives2D;
 //-----------------------------------------------------------------------------
 Player::Player()
     : m_position(Vec2(Settings::WINDOW_WIDTH / 2, Settings::WINDOW_HEIGHT / 2))
+    , m_previousPosition(m_position)
 {}
 
 
 //-----------------------------------------------------------------------------
 // Applies velocity to position, checks for all player collisions, 
-// creates shape for body, updates shotgun and cursor  
+// updates shotgun and cursor, called once per fixed simulation step
 //-----------------------------------------------------------------------------
-void Player::Update(const std::vector<Rect>& environment,
-                    std::vector<GameObjects::AmmoCrate>& ammoCrates,
-                    std::vector<GameObjects::Key>& keys, 
-                    const std::vector<GameObjects::TransitionBox>& transitionBoxes,
-                    const std::vector<Primitives2D::Circle>& enemies,
+void Player::Update(std::span<const Rect> environment,
+                    std::pmr::vector<GameObjects::AmmoCrate>& ammoCrates,
+                    std::pmr::vector<GameObjects::Key>& keys, 
+                    std::span<const GameObjects::TransitionBox> transitionBoxes,
+                    EnemyGrid& enemyGrid,
+                    StaticGrid& levelGrid,
                     const Vec2& mousePos, 
                     double deltaTime)
 {
+    PROFILE_ZONE("Player::Update");
+
     // Only thing that needs to be updated when player is dead is enemy collisions
     // Because of pseudo-timer
     if (m_isDead)
     {
-        CheckForEnemyCollisions(enemies);
+        CheckForEnemyCollisions(enemyGrid);
         return;
     }
     
-    // Apply position and decrease velocity
-    m_position += m_velocity * deltaTime;
+    // Apply position and decrease velocity, moving stops at walls so fast
+    // movement or long steps can't pass through them
+    m_previousPosition = m_position;
+    MoveAndSlide(m_velocity * static_cast<float>(deltaTime), environment, transitionBoxes, levelGrid);
     m_velocity *= 0.9f;
 
-    // Check for collisions with all game objects
-    CheckForWallCollisions(environment);
-    CheckForTransitionCollisions(transitionBoxes);
-    CheckForAmmoPickups(ammoCrates);
-    CheckForKeyPickups(keys);
-    CheckForEnemyCollisions(enemies);
+    // Check for collisions with all game objects, wall checks only push the
+    // player out of walls it already overlaps, static objects are only
+    // tested if they are in grid cells near the player, same for enemies
+    CheckForWallCollisions(environment, levelGrid);
+    CheckForTransitionCollisions(transitionBoxes, levelGrid);
+    CheckForAmmoPickups(ammoCrates, levelGrid);
+    CheckForKeyPickups(keys, levelGrid);
+    CheckForEnemyCollisions(enemyGrid);
 
-    // Creates shape for body, updates shotgun and cursor  
-    m_body = CreateUniformShape(m_position, 10.0f, 8);
+    // Updates shotgun and cursor
     m_shotgun.Update(deltaTime);
     UpdateCursor(mousePos);
 }
 
 
 //-----------------------------------------------------------------------------
-// Renders body shape, shotgun blasts and cursor shape
+// Renders body shape, shotgun blasts and cursor shape, body is drawn alpha
+// of the way from the last position to the current one
 //-----------------------------------------------------------------------------
-void Player::Render() const
+void Player::Render(float alpha) const
 {
     // No need to render anything if player is dead
     if (m_isDead) return;
 
     // Renders body shape
-    for (const LineSegment& line : m_body)
+    LineSegment body[8];
+    CreateUniformShape(m_previousPosition + (m_position - m_previousPosition) * alpha, 10.0f, body);
+    for (const LineSegment& line : body)
         line.Render(0, 255, 0, 255);
 
     // Renders shoutgun blasts
     m_shotgun.Render();
    
     // Render cursor center shape
-    const std::vector<Primitives2D::LineSegment> centerShape = CreateUniformShape(m_mousePos, m_cursorCurrentRadius, 8);
+    LineSegment centerShape[8];
+    CreateUniformShape(m_mousePos, m_cursorCurrentRadius, centerShape);
     for (const LineSegment& segment : centerShape)
         segment.Render(255, 0, 0, 255);
 }
@@ -126,14 +139,15 @@ void Player::Move(enum Direction dir, double deltaTime)
 
 
 //-----------------------------------------------------------------------------
-// Helper function for Shotgun::Shoot() 
+// Helper function for Shotgun::Shoot(), playerSight has to be built
+// from the player's current position, returns true if a shot was fired
 //-----------------------------------------------------------------------------
-void Player::Shoot(const std::vector<Rect>& environment, const Vec2& mousePos)
+bool Player::Shoot(const VisibilityPolygon& playerSight, const Vec2& mousePos)
 {
     // Shouldn't shoot if player is dead
-    if (m_isDead) return;
+    if (m_isDead) return false;
 
-    m_shotgun.Shoot(environment, m_position, mousePos, m_cursorCurrentRadius);
+    return m_shotgun.Shoot(playerSight, mousePos, m_cursorCurrentRadius);
 }
 
 
@@ -149,17 +163,122 @@ void Player::Reload()
 }
 
 
+//-----------------------------------------------------------------------------
+// Box around the hitbox, what grid queries for nearby objects use
+//-----------------------------------------------------------------------------
+Rect Player::GetHitboxBounds() const
+{
+    Rect bounds;
+    bounds.min = m_position - Vec2(m_hitboxRadius, m_hitboxRadius);
+    bounds.max = m_position + Vec2(m_hitboxRadius, m_hitboxRadius);
+    return bounds;
+}
+
+
+//-----------------------------------------------------------------------------
+// Moves the player by displacement, stops just before the first wall hit
+// and slides along it with what is left of the move
+//-----------------------------------------------------------------------------
+void Player::MoveAndSlide(Vec2 displacement, std::span<const Rect> environment, std::span<const GameObjects::TransitionBox> transitionBoxes, StaticGrid& levelGrid)
+{
+    for (int slide = 0; slide < m_MAX_SLIDES; slide++)
+    {
+        const float length = displacement.Length();
+        if (length < m_COLLISION_SKIN) return;
+
+        float timeOfImpact;
+        Vec2 normal;
+        if (!FindFirstWallHit(displacement, environment, transitionBoxes, levelGrid, timeOfImpact, normal))
+        {
+            m_position += displacement;
+            return;
+        }
+
+        // Moves up to the wall, leaving a small gap so the next sweep
+        // doesn't start touching it
+        const float travel = std::max(0.0f, timeOfImpact * length - m_COLLISION_SKIN);
+        m_position += displacement * (travel / length);
+
+        // Rest of the move slides along the wall
+        displacement *= 1.0f - timeOfImpact;
+        displacement -= normal * Vec2::Dot(displacement, normal);
+
+        // Same response as the overlap checks, removes velocity into the wall
+        float dotProduct = Vec2::Dot(m_velocity, normal);
+        if (dotProduct < 0)
+        {
+            m_velocity -= normal * dotProduct;
+            m_velocity *= 0.8f; // Apply friction
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Sweeps the player hitbox along displacement against every wall and
+// locked transition box near the move, returns the earliest hit
+//-----------------------------------------------------------------------------
+bool Player::FindFirstWallHit(const Vec2& displacement,
+                              std::span<const Rect> environment,
+                              std::span<const GameObjects::TransitionBox> transitionBoxes,
+                              StaticGrid& levelGrid,
+                              float& timeOfImpact,
+                              Vec2& normal) const
+{
+    const Circle hitbox(m_position, m_hitboxRadius);
+    bool hasHit = false;
+    timeOfImpact = 1.0f;
+
+    // Everything the hitbox can touch along the way
+    const Vec2 end = m_position + displacement;
+    Rect sweptBounds;
+    sweptBounds.min = Vec2(std::min(m_position.x, end.x) - m_hitboxRadius, std::min(m_position.y, end.y) - m_hitboxRadius);
+    sweptBounds.max = Vec2(std::max(m_position.x, end.x) + m_hitboxRadius, std::max(m_position.y, end.y) + m_hitboxRadius);
+
+    for (uint32_t i : levelGrid.Query(GridLayer::Walls, sweptBounds))
+    {
+        float time;
+        Vec2 wallNormal;
+        if (!SweepCircleRect(hitbox, displacement, environment[i], time, wallNormal) || time >= timeOfImpact) continue;
+
+        timeOfImpact = time;
+        normal = wallNormal;
+        hasHit = true;
+    }
+
+    for (uint32_t i : levelGrid.Query(GridLayer::Transitions, sweptBounds))
+    {
+        const GameObjects::TransitionBox& box = transitionBoxes[i];
+
+        // Unlocked boxes have to be walked into to transition
+        if (m_pGame->GetWorldState().Contains(m_pGame->GetCurrentLevelID(), GameObjects::GameObjectsEnum::Keys, box.keyID)) continue;
+
+        float time;
+        Vec2 wallNormal;
+        if (!SweepCircleRect(hitbox, displacement, box.bounds, time, wallNormal) || time >= timeOfImpact) continue;
+
+        timeOfImpact = time;
+        normal = wallNormal;
+        hasHit = true;
+    }
+
+    return hasHit;
+}
+
+
 //-----------------------------------------------------------------------------
 // Checks for wall collisions and applies proper velocity adjustments
 //-----------------------------------------------------------------------------
-void Player::CheckForWallCollisions(const std::vector<Rect>& environment)
+void Player::CheckForWallCollisions(std::span<const Rect> environment, StaticGrid& levelGrid)
 {
     bool collided = false;
     Vec2 totalCorrection(0, 0);
 
-    // Check collisions with all walls
-    for (const Rect& wall : environment)
+    // Check collisions with all walls near the player
+    for (uint32_t i : levelGrid.Query(GridLayer::Walls, GetHitboxBounds()))
     {
+        const Rect& wall = environment[i];
+
         // Do nothing if player has not collided
         if (!CheckRectCircleCollision(wall, { m_position, m_hitboxRadius })) continue;
 
@@ -208,19 +327,22 @@ void Player::CheckForWallCollisions(const std::vector<Rect>& environment)
 // Checks for transition box collisions and do normal wall collisions if 
 // transition box hasn't been unlocked, otherwise transition to new level
 //-----------------------------------------------------------------------------
-void Player::CheckForTransitionCollisions(const std::vector<GameObjects::TransitionBox>& transitionBoxes)
+void Player::CheckForTransitionCollisions(std::span<const GameObjects::TransitionBox> transitionBoxes, StaticGrid& levelGrid)
 {
-    for (const GameObjects::TransitionBox& box : transitionBoxes)
+    for (uint32_t i : levelGrid.Query(GridLayer::Transitions, GetHitboxBounds()))
     {
+        const GameObjects::TransitionBox& box = transitionBoxes[i];
+        const Rect& bounds = box.bounds;
+
         // Do nothing if player is not colliding
-        if (!CheckRectCircleCollision(box, { m_position, m_hitboxRadius })) continue;
+        if (!CheckRectCircleCollision(bounds, { m_position, m_hitboxRadius })) continue;
 
         // Check if the player should transition
-        if (m_pGame->GetUnlockedObjects().test(static_cast<int>(GameObjects::GameObjectsEnum::Keys) * 65536 + box.keyID))
+        if (m_pGame->GetWorldState().Contains(m_pGame->GetCurrentLevelID(), GameObjects::GameObjectsEnum::Keys, box.keyID))
         {
             // Puts player in the right position
             // True if transition box is on the bottom or top of the screen
-            if ((box.GetTopLeft() - box.GetTopRight()).Length() < (box.GetTopLeft() - box.GetBottomLeft()).Length())
+            if ((bounds.GetTopLeft() - bounds.GetTopRight()).Length() < (bounds.GetTopLeft() - bounds.GetBottomLeft()).Length())
             {
                 // True if transition box is on the right
                 if (m_position.x > Settings::WINDOW_WIDTH / 2)
@@ -237,18 +359,22 @@ void Player::CheckForTransitionCollisions(const std::vector<GameObjects::Transit
                     m_position.y = Settings::WINDOW_HEIGHT - 50;
             }
 
+            // Teleports, so don't interpolate from the old side of the screen
+            m_previousPosition = m_position;
+
             // Removes all shotgun traces
             m_shotgun.ClearTraces();
 
-            // Just loads a new level
-            m_pGame->LoadLevel(box.nextLevelID);
+            // New level is loaded once the player is done with this one
+            m_pGame->RequestLevel(box.nextLevelID);
+            return;
         }
         else
         {
             // Find closest point on wall to player center
             Vec2 closest(
-                std::clamp(m_position.x, box.min.x, box.max.x),
-                std::clamp(m_position.y, box.min.y, box.max.y)
+                std::clamp(m_position.x, bounds.min.x, bounds.max.x),
+                std::clamp(m_position.y, bounds.min.y, bounds.max.y)
             );
 
             // Calculate penetration vector
@@ -288,23 +414,23 @@ void Player::CheckForTransitionCollisions(const std::vector<GameObjects::Transit
 // Checks for ammo box collisions, player picks up ammo if current reserve 
 // ammo is not maxed out
 //-----------------------------------------------------------------------------
-void Player::CheckForAmmoPickups(std::vector<GameObjects::AmmoCrate>& ammoCrates)
+void Player::CheckForAmmoPickups(std::pmr::vector<GameObjects::AmmoCrate>& ammoCrates, StaticGrid& levelGrid)
 {
     // Don't pickup if ammo is already maxed out
     if (m_shotgun.GetCurrentReserveAmmo() >= m_shotgun.GetMaxReserveAmmo()) return;
 
-    for (size_t i = 0; i < ammoCrates.size(); i++)
+    for (uint32_t i : levelGrid.Query(GridLayer::AmmoCrates, GetHitboxBounds()))
     {
-        if (CheckRectCircleCollision(Primitives2D::Rect(ammoCrates[i].GetTopLeft(), ammoCrates[i].GetWidth(), ammoCrates[i].GetHeight()), { m_position, m_hitboxRadius }))
+        if (CheckRectCircleCollision(ammoCrates[i].bounds, { m_position, m_hitboxRadius }))
         {
             m_shotgun.AddReserveAmmo(ammoCrates[i].ammoCount);
 
-            // Add ammoCrate to m_unlockedGameObjects in Game class
-            // Change this, do not pass in 0
+            // Add ammoCrate to world state in Game class
             UnlockGameObject(GameObjects::GameObjectsEnum::AmmoCrates, ammoCrates[i].ID);
 
-            // Remove object from list
-            ammoCrates.erase(ammoCrates.begin() + i);
+            // Remove object from list, order doesn't matter
+            SwapAndPop(ammoCrates, i);
+            levelGrid.SwapAndPop(GridLayer::AmmoCrates, i);
             AudioManager::GetInstance().Play(AudioEnum::AmmoPickedUp);
 
             break;
@@ -316,18 +442,18 @@ void Player::CheckForAmmoPickups(std::vector<GameObjects::AmmoCrate>& ammoCrates
 //-----------------------------------------------------------------------------
 // Checks for key collisions, player picks up key upon collision
 //-----------------------------------------------------------------------------
-void Player::CheckForKeyPickups(std::vector<GameObjects::Key>& keys)
+void Player::CheckForKeyPickups(std::pmr::vector<GameObjects::Key>& keys, StaticGrid& levelGrid)
 {
-    for (size_t i = 0; i < keys.size(); i++)
+    for (uint32_t i : levelGrid.Query(GridLayer::Keys, GetHitboxBounds()))
     {
-        if (CheckRectCircleCollision(Primitives2D::Rect(keys[i].GetTopLeft(), keys[i].GetWidth(), keys[i].GetHeight()), { m_position, m_hitboxRadius }))
+        if (CheckRectCircleCollision(keys[i].bounds, { m_position, m_hitboxRadius }))
         {
-            // Add ammoCrate to m_unlockedGameObjects in Game class
-            // Change this, do not pass in 1
+            // Add key to world state in Game class
             UnlockGameObject(GameObjects::GameObjectsEnum::Keys, keys[i].ID);
 
-            // Remove object from list
-            keys.erase(keys.begin() + i);
+            // Remove object from list, order doesn't matter
+            SwapAndPop(keys, i);
+            levelGrid.SwapAndPop(GridLayer::Keys, i);
             AudioManager::GetInstance().Play(AudioEnum::KeyPickedUp);
 
             break;
@@ -337,28 +463,30 @@ void Player::CheckForKeyPickups(std::vector<GameObjects::Key>& keys)
 
 
 //-----------------------------------------------------------------------------
-// Checks for enemy collisions, game restarts upon collision
+// Checks for enemy collisions, game restarts upon collision, only enemies
+// in grid cells near the player are tested
 //-----------------------------------------------------------------------------
-void Player::CheckForEnemyCollisions(const std::vector<Primitives2D::Circle>& enemies)
+void Player::CheckForEnemyCollisions(EnemyGrid& enemyGrid)
 {
-    for (const Primitives2D::Circle& enemy : enemies)
+    for (uint32_t i : enemyGrid.Query(GetHitboxBounds()))
     {
-        if (!CheckCircleCircleCollision({ m_position, m_hitboxRadius }, enemy)) continue;
+        if (!CheckCircleCircleCollision({ m_position, m_hitboxRadius }, enemyGrid.GetHitbox(i))) continue;
         
         // Runs when player is in game over screen
         if (m_isDead)
         {
             // Resets all unlocked game objects
-            m_pGame->GetUnlockedObjects().reset();
+            m_pGame->GetWorldState().Clear();
 
             // Places player at middle of screen
             m_position = { Settings::WINDOW_WIDTH / 2, Settings::WINDOW_HEIGHT / 2 };
+            m_previousPosition = m_position;
             m_velocity = Vec2::Zero();
 
             // Starts song again
             AudioManager::GetInstance().Play(AudioEnum::Music);
 
-            m_pGame->LoadLevel(1);
+            m_pGame->RequestLevel(1);
             m_isDead = false;
         }
         // Puts player into game over screen when touching an enemy
@@ -376,8 +504,9 @@ void Player::CheckForEnemyCollisions(const std::vector<Primitives2D::Circle>& en
             m_shotgun.ClearTraces();
 
             m_position = { -3000.0f, 0.0f };
+            m_previousPosition = m_position;
 
-            m_pGame->LoadLevel(999); // Game over screen
+            m_pGame->RequestLevel(Game::GAME_OVER_LEVEL_ID);
         }
     }
 }
@@ -386,7 +515,7 @@ void Player::CheckForEnemyCollisions(const std::vector<Primitives2D::Circle>& en
 //-----------------------------------------------------------------------------
 // Unlocks specified game object in main game instance
 //-----------------------------------------------------------------------------
-void Player::UnlockGameObject(GameObjects::GameObjectsEnum type, uint16_t ID)
+void Player::UnlockGameObject(GameObjects::GameObjectsEnum type, uint32_t ID)
 {
-    m_pGame->GetUnlockedObjects().set(static_cast<int>(type) * 65536 + ID);
+    m_pGame->GetWorldState().Insert(m_pGame->GetCurrentLevelID(), type, ID);
 }
\ No newline at end of file
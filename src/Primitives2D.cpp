@@ -1,6 +1,7 @@
 #include "Primitives2D.h"
 
 #include "RendererManager.h"
+#include "Metrics.h"
 
 namespace Primitives2D
 {
@@ -11,6 +12,7 @@ namespace Primitives2D
     {
         SDL_Renderer* renderer = RendererManager::GetInstance().GetRenderer();
         SDL_SetRenderDrawColor(renderer, r, g, b, a);
+        Metrics::GetInstance().Add(MetricCounter::DrawCalls);
         if (!SDL_RenderLine(renderer, start.x, start.y, end.x, end.y))
         {
             std::cout << "SDL_RenderLine in LineSegment failed! Error: " << SDL_GetError() << '\n';
@@ -22,36 +24,38 @@ namespace Primitives2D
     // Renders a rect with a specified color and opacity, can render both 
     // filled and non-filled rects
     //-----------------------------------------------------------------------------
-    void Rect::Render(uint8_t r, uint8_t g, uint8_t b, uint8_t a, bool fillRect) const
+    void RenderRect(const Rect& rect, uint8_t r, uint8_t g, uint8_t b, uint8_t a, bool fillRect)
     {
         SDL_Renderer* renderer = RendererManager::GetInstance().GetRenderer();
         SDL_SetRenderDrawColor(renderer, r, g, b, a);
 
-        const SDL_FRect rect = { min.x, min.y, GetWidth(), GetHeight() };
+        const SDL_FRect renderRect = { rect.min.x, rect.min.y, rect.GetWidth(), rect.GetHeight() };
+        Metrics::GetInstance().Add(MetricCounter::DrawCalls);
         // If rectangle should be a solid color
         if (fillRect) 
         {
-            if (!SDL_RenderFillRect(renderer, &rect))
+            if (!SDL_RenderFillRect(renderer, &renderRect))
             {
-                std::cerr << "SDL_RenderFillRect in struct Rect failed! Error: " << SDL_GetError() << '\n';
+                std::cerr << "SDL_RenderFillRect in RenderRect failed! Error: " << SDL_GetError() << '\n';
             }
             return;
         }
         // If rectangle should be rendered hollow in the middle
-        if (!SDL_RenderRect(renderer, &rect))
+        if (!SDL_RenderRect(renderer, &renderRect))
         {
-            std::cerr << "SDL_RenderRect in struct Rect failed! Error: " << SDL_GetError() << '\n';
+            std::cerr << "SDL_RenderRect in RenderRect failed! Error: " << SDL_GetError() << '\n';
         }
     }
 
 
     //-----------------------------------------------------------------------------
-    // Returns a vector of {sides} element, shaped in a uniform shape around
-    // {pos} with a radius of {radius}
+    // Fills {segments} with a uniform shape around {pos} with a radius of
+    // {radius}, one side per segment, writes into the callers storage so
+    // shapes rebuilt every frame don't allocate
     //-----------------------------------------------------------------------------
-    std::vector<LineSegment> CreateUniformShape(const Vec2& pos, float radius, int sides)
+    void CreateUniformShape(const Vec2& pos, float radius, std::span<LineSegment> segments)
     {
-        std::vector<LineSegment> segments;
+        const int sides = static_cast<int>(segments.size());
 
         // Calculate points for a regular shape
         for (int i = 0; i < sides; i++)
@@ -65,10 +69,8 @@ namespace Primitives2D
             Vec2 p2(pos.x + radius * cosf(angle2),
                 pos.y + radius * sinf(angle2));
 
-            segments.push_back(LineSegment(p1, p2));
+            segments[i] = LineSegment(p1, p2);
         }
-
-        return segments;
     }
 
 
@@ -307,4 +309,86 @@ namespace Primitives2D
         // Check if distance is less than or equal to circle radius
         return lengthSquared <= circle.radius * circle.radius;
     }
+
+
+    //-----------------------------------------------------------------------------
+    // Moves circle by displacement and returns true if it touches rect on the
+    // way, timeOfImpact is how far along displacement (0 to 1) it first
+    // touches and normal points out of the rect at that point
+    // Circles already overlapping rect return false, those are pushed out by
+    // the normal overlap checks instead
+    //-----------------------------------------------------------------------------
+    bool SweepCircleRect(const Circle& circle, const Vec2& displacement, const Rect& rect, float& timeOfImpact, Vec2& normal)
+    {
+        if (CheckRectCircleCollision(rect, circle)) return false;
+
+        // Same as a ray from the circle center against the rect grown by the
+        // radius, with rounded corners
+        const float radius = circle.radius;
+        const Vec2 start = circle.center;
+        const float grownMin[2] = { rect.min.x - radius, rect.min.y - radius };
+        const float grownMax[2] = { rect.max.x + radius, rect.max.y + radius };
+        const float origin[2] = { start.x, start.y };
+        const float direction[2] = { displacement.x, displacement.y };
+
+        // Slab test, the ray enters the grown rect at the latest entry of both axes
+        float enter = 0.0f;
+        float exit = 1.0f;
+        int enterAxis = -1;
+        for (int axis = 0; axis < 2; axis++)
+        {
+            if (std::abs(direction[axis]) < 0.000001f)
+            {
+                // Moving parallel to this axis' sides, has to be between them already
+                if (origin[axis] < grownMin[axis] || origin[axis] > grownMax[axis]) return false;
+                continue;
+            }
+
+            float near = (grownMin[axis] - origin[axis]) / direction[axis];
+            float far = (grownMax[axis] - origin[axis]) / direction[axis];
+            if (near > far) std::swap(near, far);
+
+            if (near > enter)
+            {
+                enter = near;
+                enterAxis = axis;
+            }
+            exit = std::min(exit, far);
+            if (enter > exit) return false;
+        }
+
+        // Doesn't reach the grown rect, or starts inside it in a corner area
+        const Vec2 hit = start + displacement * enter;
+        const bool outsideX = hit.x < rect.min.x || hit.x > rect.max.x;
+        const bool outsideY = hit.y < rect.min.y || hit.y > rect.max.y;
+
+        // Hit a side, the normal is the axis it entered on
+        if (enterAxis != -1 && !(outsideX && outsideY))
+        {
+            timeOfImpact = enter;
+            normal = Vec2::Zero();
+            if (enterAxis == 0) normal.x = direction[0] > 0.0f ? -1.0f : 1.0f;
+            else                normal.y = direction[1] > 0.0f ? -1.0f : 1.0f;
+            return true;
+        }
+
+        // Hit a corner area, the grown rect is round there so intersect
+        // the ray with a circle around the corner instead
+        const Vec2 corner(hit.x < rect.min.x ? rect.min.x : rect.max.x,
+                          hit.y < rect.min.y ? rect.min.y : rect.max.y);
+        const Vec2 toStart = start - corner;
+
+        const float a = displacement.LengthSquared();
+        const float b = Vec2::Dot(toStart, displacement);
+        const float c = toStart.LengthSquared() - radius * radius;
+        const float discriminant = b * b - a * c;
+        if (a <= 0.0f || discriminant < 0.0f) return false;
+
+        const float time = (-b - std::sqrt(discriminant)) / a;
+        if (time < 0.0f || time > 1.0f) return false;
+
+        timeOfImpact = time;
+        normal = (start + displacement * time - corner) / radius;
+        return true;
+    }
 }
\ No newline at end of file
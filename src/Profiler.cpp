@@ -0,0 +1,171 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+// Zone buffer of the calling thread, created the first time it records a zone
+static thread_local ThreadZoneBuffer* s_threadBuffer = nullptr;
+
+// Innermost open zone of the calling thread
+static thread_local const char* s_currentZone = nullptr;
+
+//-----------------------------------------------------------------------------
+// Returns reference to singelton instance
+//-----------------------------------------------------------------------------
+Profiler& Profiler::GetInstance()
+{
+    static Profiler instance;
+    return instance;
+}
+
+
+//-----------------------------------------------------------------------------
+// Constructor, all zone times are relative to when the profiler was created
+//-----------------------------------------------------------------------------
+Profiler::Profiler()
+    : m_startTime(std::chrono::steady_clock::now())
+{}
+
+
+//-----------------------------------------------------------------------------
+// Destructor, frees every threads zone buffer
+//-----------------------------------------------------------------------------
+Profiler::~Profiler()
+{
+    uint32_t bufferCount = m_bufferCount.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < bufferCount; i++)
+    {
+        delete m_buffers[i];
+        m_buffers[i] = nullptr;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Returns nanoseconds since the profiler was created
+//-----------------------------------------------------------------------------
+uint64_t Profiler::Now() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_startTime).count();
+}
+
+
+//-----------------------------------------------------------------------------
+// Returns name of the innermost zone open on the calling thread
+//-----------------------------------------------------------------------------
+const char* Profiler::GetCurrentZone()
+{
+    return s_currentZone;
+}
+
+
+//-----------------------------------------------------------------------------
+// Sets innermost zone of the calling thread, only used by ProfileZone
+//-----------------------------------------------------------------------------
+void Profiler::SetCurrentZone(const char* name)
+{
+    s_currentZone = name;
+}
+
+
+//-----------------------------------------------------------------------------
+// Adds a finished zone to the calling threads ring buffer, overwrites the
+// oldest zone when the buffer is full
+//-----------------------------------------------------------------------------
+void Profiler::RecordZone(const char* name, uint64_t start, uint64_t end)
+{
+    ThreadZoneBuffer* buffer = GetThreadBuffer();
+    if (!buffer) return;
+
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    buffer->events[head & (ThreadZoneBuffer::CAPACITY - 1)] = { name, start, end };
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+
+//-----------------------------------------------------------------------------
+// Returns the calling threads zone buffer, registers a new one the first
+// time a thread records a zone, returns nullptr if too many threads have
+//-----------------------------------------------------------------------------
+ThreadZoneBuffer* Profiler::GetThreadBuffer()
+{
+    if (s_threadBuffer) return s_threadBuffer;
+
+    std::lock_guard<std::mutex> lock(m_registerMutex);
+
+    uint32_t index = m_bufferCount.load(std::memory_order_relaxed);
+    if (index >= MAX_THREADS) return nullptr;
+
+    ThreadZoneBuffer* buffer = new ThreadZoneBuffer();
+    buffer->threadIndex = index;
+    m_buffers[index] = buffer;
+    m_bufferCount.store(index + 1, std::memory_order_release);
+
+    s_threadBuffer = buffer;
+    return buffer;
+}
+
+
+//-----------------------------------------------------------------------------
+// Writes every zone still in the ring buffers to a Chrome trace_event JSON
+// file, open it in chrome://tracing or ui.perfetto.dev
+// Threads keep recording while this runs, zones overwritten during the
+// copy are skipped
+//-----------------------------------------------------------------------------
+bool Profiler::WriteChromeTrace(const char* filepath) const
+{
+    FILE* file = fopen(filepath, "wb");
+    if (!file)
+    {
+        std::cerr << "Could not open profiler trace file: " << filepath << '\n';
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    std::vector<ZoneEvent> events;
+    bool firstEvent = true;
+    size_t eventCount = 0;
+
+    uint32_t bufferCount = m_bufferCount.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < bufferCount; i++)
+    {
+        const ThreadZoneBuffer* buffer = m_buffers[i];
+
+        // Copies the buffer so the owning thread can keep writing
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t first = head > ThreadZoneBuffer::CAPACITY ? head - ThreadZoneBuffer::CAPACITY : 0;
+        events.resize(head - first);
+        for (uint64_t j = first; j < head; j++)
+        {
+            events[j - first] = buffer->events[j & (ThreadZoneBuffer::CAPACITY - 1)];
+        }
+
+        // Anything older than CAPACITY zones behind the new head might have been overwritten
+        uint64_t newHead = buffer->head.load(std::memory_order_acquire);
+        uint64_t firstValid = newHead > ThreadZoneBuffer::CAPACITY ? newHead - ThreadZoneBuffer::CAPACITY : 0;
+
+        // Names the thread in the trace viewer
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Thread %u\"}}",
+            firstEvent ? "" : ",\n", buffer->threadIndex, buffer->threadIndex);
+        firstEvent = false;
+
+        for (uint64_t j = std::max(first, firstValid); j < head; j++)
+        {
+            const ZoneEvent& event = events[j - first];
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                event.name,
+                buffer->threadIndex,
+                event.start / 1000.0,
+                (event.end - event.start) / 1000.0);
+            eventCount++;
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    std::cout << "Wrote " << eventCount << " profiler zones to " << filepath << '\n';
+    return true;
+}
@@ -0,0 +1,68 @@
+#include "Random.h"
+
+namespace
+{
+    RandomStream s_streams[static_cast<int>(Random::Stream::STREAM_COUNT)];
+}
+
+
+//-----------------------------------------------------------------------------
+// Seeds generator, streams with the same seed but a different streamID
+// produce unrelated sequences
+//-----------------------------------------------------------------------------
+void RandomStream::Seed(uint64_t seed, uint64_t streamID)
+{
+    m_state = 0;
+    m_increment = (streamID << 1) | 1; // Has to be odd
+    NextUint();
+    m_state += seed;
+    NextUint();
+}
+
+
+//-----------------------------------------------------------------------------
+// Returns next 32 random bits
+//-----------------------------------------------------------------------------
+uint32_t RandomStream::NextUint()
+{
+    uint64_t oldState = m_state;
+    m_state = oldState * 6364136223846793005ULL + m_increment;
+
+    uint32_t xorShifted = static_cast<uint32_t>(((oldState >> 18) ^ oldState) >> 27);
+    uint32_t rotation = static_cast<uint32_t>(oldState >> 59);
+    return (xorShifted >> rotation) | (xorShifted << ((32 - rotation) & 31));
+}
+
+
+//-----------------------------------------------------------------------------
+// Returns a random float in [0, 1), uses the top 24 bits since
+// that is all a float can represent exactly
+//-----------------------------------------------------------------------------
+float RandomStream::NextFloat()
+{
+    return static_cast<float>(NextUint() >> 8) * (1.0f / 16777216.0f);
+}
+
+
+namespace Random
+{
+    //-----------------------------------------------------------------------------
+    // Seeds every stream from a single seed
+    //-----------------------------------------------------------------------------
+    void SeedAll(uint32_t seed)
+    {
+        for (int i = 0; i < static_cast<int>(Stream::STREAM_COUNT); i++)
+        {
+            s_streams[i].Seed(seed, static_cast<uint64_t>(i));
+        }
+    }
+
+
+    //-----------------------------------------------------------------------------
+    // Returns a stream, only use streams from the main thread
+    //-----------------------------------------------------------------------------
+    RandomStream& Get(Stream stream)
+    {
+        return s_streams[static_cast<int>(stream)];
+    }
+}
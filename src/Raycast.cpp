@@ -1,29 +1,32 @@
 #include "Raycast.h"
 #include "RendererManager.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "Metrics.h"
 #include <algorithm>
 
 using namespace Primitives2D;
 
 //-----------------------------------------------------------------------------
-// Renders each LineSegment in the raycast with a specified color and opacity
+// Renders each ray in the raycast with a specified color and opacity
 // Can also render every hitpoint for each ray
 //-----------------------------------------------------------------------------
 void Raycast::Render(bool drawHits, uint8_t r, uint8_t g, uint8_t b, uint8_t a) const
 {
     // Render each ray as a line from origin to intersection point
-    for (const LineSegment& ray : m_rays)
+    for (const Vec2& rayEnd : m_rayEnds)
     {
-        ray.Render(r, g, b, a);
+        LineSegment(m_origin, rayEnd).Render(r, g, b, a);
     }
        
     if (!drawHits) return;
 
-    // Draw ray hit points
+    // Draw ray hit points, every ray ends where it hit
     SDL_Renderer* renderer = RendererManager::GetInstance().GetRenderer();
     SDL_SetRenderDrawColor(renderer, 200, 0, 0, 255);
-    for (const Vec2& hit : m_rayHits)
+    for (const Vec2& hit : m_rayEnds)
     {
-        Rect(Vec2(hit.x - 5, hit.y - 5), 10, 10).Render(r, g, b, a);
+        RenderRect(Rect(Vec2(hit.x - 5, hit.y - 5), 10, 10), r, g, b, a);
     }
 }
 
@@ -31,11 +34,11 @@ void Raycast::Render(bool drawHits, uint8_t r, uint8_t g, uint8_t b, uint8_t a)
 //-----------------------------------------------------------------------------
 // Renders a filled shape of every raycast LineSegment, 
 // call SortRays() before this
-// Used for enemy fov visualisation
+// Used for enemy fov visualisation, offset moves the whole shape
 //-----------------------------------------------------------------------------
-void Raycast::RenderGeometry() const
+void Raycast::RenderGeometry(const Vec2& offset) const
 {
-    size_t rayCount = m_rays.size();
+    size_t rayCount = m_rayEnds.size();
 
     // Can't render tris with only 1 ray
     if (rayCount <= 1)
@@ -54,13 +57,17 @@ void Raycast::RenderGeometry() const
         if (nextIdx == 0) break;
 
         // Defines vertices for tri to render
+        const Vec2 origin = m_origin + offset;
+        const Vec2 current = m_rayEnds[i] + offset;
+        const Vec2 next = m_rayEnds[nextIdx] + offset;
         SDL_Vertex vertices[] = {
-            {{m_rays[i].start.x, m_rays[i].start.y},         {1.0f, 1.0f, 0.0f, 0.5f}}, // Origin point
-            {{m_rays[i].end.x, m_rays[i].end.y},             {1.0f, 1.0f, 0.0f, 0.5f}}, // Current ray end point
-            {{m_rays[nextIdx].end.x, m_rays[nextIdx].end.y}, {1.0f, 1.0f, 0.0f, 0.5f}}, // Next ray end point
+            {{origin.x, origin.y},   {1.0f, 1.0f, 0.0f, 0.5f}}, // Origin point
+            {{current.x, current.y}, {1.0f, 1.0f, 0.0f, 0.5f}}, // Current ray end point
+            {{next.x, next.y},       {1.0f, 1.0f, 0.0f, 0.5f}}, // Next ray end point
         };
 
         // Renders tris
+        Metrics::GetInstance().Add(MetricCounter::DrawCalls);
         if (!SDL_RenderGeometry(renderer, NULL, vertices, 3, NULL, 0))
         {
             std::cout << "Raycast RenderGeometry failed! Error: " << SDL_GetError() << '\n';
@@ -72,27 +79,49 @@ void Raycast::RenderGeometry() const
 //-----------------------------------------------------------------------------
 // Sort rays based upon angle
 // Call before using RenderGeometry()
+// Sorts 8 byte angle/index keys and then moves every end point once,
+// instead of swapping whole rays around
 //-----------------------------------------------------------------------------
 void Raycast::SortRays()
 {
-    std::sort(m_rays.begin(), m_rays.end(), [](LineSegment a, LineSegment b) { return a.angle < b.angle; });
+    const size_t rayCount = m_rayEnds.size();
+
+    m_sortKeys.resize(rayCount);
+    for (size_t i = 0; i < rayCount; i++)
+    {
+        m_sortKeys[i] = { m_rayAngles[i], static_cast<uint32_t>(i) };
+    }
+
+    std::sort(m_sortKeys.begin(), m_sortKeys.end(), [](const SortKey& a, const SortKey& b) { return a.angle < b.angle; });
+
+    m_sortedEnds.resize(rayCount);
+    for (size_t i = 0; i < rayCount; i++)
+    {
+        m_sortedEnds[i] = m_rayEnds[m_sortKeys[i].index];
+        m_rayAngles[i] = m_sortKeys[i].angle;
+    }
+
+    m_rayEnds.swap(m_sortedEnds);
 }
 
 
 //-----------------------------------------------------------------------------
 // Casts rays at every wall vertex within a area defined by fov and fovCenter
 //-----------------------------------------------------------------------------
-void Raycast::CastRaysAtVertices(const Vec2& origin, const std::vector<Rect>& environment, const Vec2& fovCenter, float fov)
+void Raycast::CastRaysAtVertices(const Vec2& origin, std::span<const Rect> environment, const Vec2& fovCenter, float fov)
 {
-    // Free up rays/rayHits to remove rays no longer needed
+    PROFILE_ZONE("Raycast::CastRaysAtVertices");
+
+    // Free up rays to remove rays no longer needed
     ResetRays();
+    m_origin = origin;
 
     // Converts angle from degrees to radians
     fov *= PI / 180.0f;
 
     // Small offset for rays left/right of main ray
     const float ANGLE_OFFSET = 0.0001f;
-    const LineSegment referenceLine(origin, fovCenter);
+    const Vec2 referenceDirection = fovCenter - origin;
 
     // Gets the angle of point in center of fov
     Vec2 toFovCenter = fovCenter - origin;
@@ -111,9 +140,11 @@ void Raycast::CastRaysAtVertices(const Vec2& origin, const std::vector<Rect>& en
     Vec2 rightRayEnd = origin + rightDir * m_RAY_LENGTH;
 
     // Casts the rays
-    FindClosestIntersection(origin, leftRayEnd, environment, referenceLine);
-    FindClosestIntersection(origin, rightRayEnd, environment, referenceLine);
+    FindClosestIntersection(origin, leftRayEnd, environment, referenceDirection);
+    FindClosestIntersection(origin, rightRayEnd, environment, referenceDirection);
 
+    // Finds every wall vertex inside the fov, cheap compared to the rays
+    m_visibleVertices.clear();
     for (const Rect& rect : environment)
     {
         // Gets all the corners of the rect
@@ -124,7 +155,6 @@ void Raycast::CastRaysAtVertices(const Vec2& origin, const std::vector<Rect>& en
             rect.GetBottomRight()
         };
 
-        // Casts to every rect corner
         for (const Vec2& vertex : corners)
         {
             // Check if vertex is in fov, continue if it is not
@@ -134,8 +164,28 @@ void Raycast::CastRaysAtVertices(const Vec2& origin, const std::vector<Rect>& en
             angleDiff = std::remainder(angleDiff, 2.0f * PI);
             if (std::abs(angleDiff) > fov / 2.0f) continue;
 
-            // Cast the main ray
-            FindClosestIntersection(origin, vertex, environment, referenceLine);
+            m_visibleVertices.push_back(vertex);
+        }
+    }
+
+    // Every vertex gets three ray slots, so batches can be cast on
+    // different threads without changing the order of the rays
+    const size_t firstVertexRay = m_rayEnds.size();
+    m_rayEnds.resize(firstVertexRay + m_visibleVertices.size() * 3);
+    m_rayAngles.resize(m_rayEnds.size());
+
+    // Small casts are run inline by the job system
+    const size_t minBatchSize = m_MIN_RECT_TESTS_PER_JOB / (3 * environment.size() + 1) + 1;
+
+    JobSystem::GetInstance().ParallelFor(m_visibleVertices.size(), minBatchSize, [&](size_t begin, size_t end)
+    {
+        PROFILE_ZONE("Raycast::CastRaysAtVertices batch");
+
+        for (size_t i = begin; i < end; i++)
+        {
+            const Vec2& vertex = m_visibleVertices[i];
+            Vec2* rayEnds = &m_rayEnds[firstVertexRay + i * 3];
+            float* rayAngles = &m_rayAngles[firstVertexRay + i * 3];
 
             // Calculate direction vector from origin to vertex
             Vec2 direction = vertex - origin;
@@ -158,41 +208,106 @@ void Raycast::CastRaysAtVertices(const Vec2& origin, const std::vector<Rect>& en
             Vec2 leftRayEnd = origin + leftDirection * m_RAY_LENGTH;
             Vec2 rightRayEnd = origin + rightDirection * m_RAY_LENGTH;
 
-            // Cast the offset rays
-            FindClosestIntersection(origin, leftRayEnd, environment, referenceLine);
-            FindClosestIntersection(origin, rightRayEnd, environment, referenceLine);
+            // Cast the main ray and the offset rays
+            bool hitWall;
+            rayEnds[0] = TraceRay(origin, vertex, environment, hitWall);
+            rayEnds[1] = TraceRay(origin, leftRayEnd, environment, hitWall);
+            rayEnds[2] = TraceRay(origin, rightRayEnd, environment, hitWall);
+
+            for (int ray = 0; ray < 3; ray++)
+            {
+                rayAngles[ray] = GetRayAngle(origin, rayEnds[ray], referenceDirection);
+            }
         }
-    }
+    });
+
+    // Every ray of the cast tests every wall, so rect tests are counted
+    // once here instead of once per test inside TraceRay
+    Metrics::GetInstance().Add(MetricCounter::RaysCast, m_visibleVertices.size() * 3);
+    Metrics::GetInstance().Add(MetricCounter::RectTests, m_visibleVertices.size() * 3 * environment.size());
 }
 
 
 //-----------------------------------------------------------------------------
 // Casts a ray from one position to another, ray can have a 
 // defined or (practically) infinite length
+// Casting from a new origin starts a new cast
+//-----------------------------------------------------------------------------
+bool Raycast::CastRayToPos(const Vec2& origin, const Vec2& pos, std::span<const Rect> environment, bool infiniteLength)
+{
+    LineSegment ray;
+    bool result = TraceRayToPos(origin, pos, environment, infiniteLength, ray);
+
+    BeginCast(origin);
+    m_rayEnds.push_back(ray.end);
+    m_rayAngles.push_back(0.0f);
+
+    return result;
+}
+
+
+//-----------------------------------------------------------------------------
+// Same as CastRayToPos, but writes the ray to ray instead of keeping it,
+// for callers that store rays themselves
 //-----------------------------------------------------------------------------
-bool Raycast::CastRayToPos(const Vec2& origin, const Vec2& pos, const std::vector<Rect>& environment, bool infiniteLength)
+bool Raycast::TraceRayToPos(const Vec2& origin, const Vec2& pos, std::span<const Rect> environment, bool infiniteLength, LineSegment& ray)
 {
     // Casts a ray to a postion, ray is infinitely long
+    Vec2 rayEnd = pos;
     if (infiniteLength)
     {
         Vec2 direction = pos - origin;
         direction.Normalize();
-        Vec2 rayEnd = origin + direction * m_RAY_LENGTH;
-        return FindClosestIntersection(origin, rayEnd, environment, LineSegment(origin, origin));
-    }
-    // Casts a ray to a postion, ray stops at pos
-    else
-    {
-        return FindClosestIntersection(origin, pos, environment, LineSegment(origin, origin));
+        rayEnd = origin + direction * m_RAY_LENGTH;
     }
+
+    Metrics::GetInstance().Add(MetricCounter::RaysCast);
+    Metrics::GetInstance().Add(MetricCounter::RectTests, environment.size());
+
+    bool hitWall;
+    ray = LineSegment(origin, TraceRay(origin, rayEnd, environment, hitWall));
+
+    return hitWall;
 }
 
 
 //-----------------------------------------------------------------------------
 // Finds the closest intersection between a ray and the walls,
-// adds the ray with calculated end point to m_rays vector
+// adds the ray with calculated end point to the cast
 //-----------------------------------------------------------------------------
-bool Raycast::FindClosestIntersection(const Vec2& origin, const Vec2& rayEnd, const std::vector<Rect>& environment, const LineSegment& referenceLine)
+bool Raycast::FindClosestIntersection(const Vec2& origin, const Vec2& rayEnd, std::span<const Rect> environment, const Vec2& referenceDirection)
+{
+    bool result;
+    const Vec2 hit = TraceRay(origin, rayEnd, environment, result);
+
+    Metrics::GetInstance().Add(MetricCounter::RaysCast);
+    Metrics::GetInstance().Add(MetricCounter::RectTests, environment.size());
+
+    BeginCast(origin);
+    m_rayEnds.push_back(hit);
+    m_rayAngles.push_back(GetRayAngle(origin, hit, referenceDirection));
+
+    return result;
+}
+
+
+//-----------------------------------------------------------------------------
+// Rays are only stored with their end point, so a ray from another origin
+// can't join the current cast
+//-----------------------------------------------------------------------------
+void Raycast::BeginCast(const Vec2& origin)
+{
+    if (!m_rayEnds.empty() && origin != m_origin) ResetRays();
+    m_origin = origin;
+}
+
+
+//-----------------------------------------------------------------------------
+// Finds the closest intersection between a ray and the walls and returns
+// where the ray stops, doesn't touch any members so it can be called from
+// several threads at once
+//-----------------------------------------------------------------------------
+Vec2 Raycast::TraceRay(const Vec2& origin, const Vec2& rayEnd, std::span<const Rect> environment, bool& hitWall)
 {
     Vec2 closestHit = rayEnd;
     float closestDistance = m_RAY_LENGTH;
@@ -220,43 +335,34 @@ bool Raycast::FindClosestIntersection(const Vec2& origin, const Vec2& rayEnd, co
         result = true;
     }
 
-    // Adds a ray that stops at the pos of the closest intersection
-    LineSegment ray(origin, closestHit);
-
-    SetRayAngle(ray, referenceLine);
-    m_rays.push_back(ray);
-    m_rayHits.push_back(closestHit);
-
-    return result;
+    // The ray stops at the pos of the closest intersection
+    hitWall = result;
+    return closestHit;
 }
 
 
 //-----------------------------------------------------------------------------
-// Sets the angle of a ray relative to a reference line
+// Gets the angle of a ray relative to a reference direction, only used
+// as a sort key
 //-----------------------------------------------------------------------------
-void Raycast::SetRayAngle(LineSegment& ray, const LineSegment& referenceLine)
+float Raycast::GetRayAngle(const Vec2& origin, const Vec2& rayEnd, const Vec2& referenceDirection)
 {
     // Calculate rays line vector
-    const Vec2 rayVec = ray.end - ray.start;
+    const Vec2 rayVec = rayEnd - origin;
 
-    // Calculate reference line's vector
-    const Vec2 refVec = referenceLine.end - referenceLine.start;
-
-    // Calculate ray angle in relation to ref line segment
-    double rAngle = std::atan2(
-        Vec2::Cross(rayVec, refVec),
-        Vec2::Dot(rayVec, refVec)
+    // Calculate ray angle in relation to reference direction
+    return std::atan2(
+        Vec2::Cross(rayVec, referenceDirection),
+        Vec2::Dot(rayVec, referenceDirection)
     );
-
-    ray.angle = rAngle;
 }
 
 
 //-----------------------------------------------------------------------------
-// Clears all rays and ray hits
+// Clears all rays, keeps their capacity for the next cast
 //-----------------------------------------------------------------------------
 void Raycast::ResetRays()
 {
-    m_rays.clear();
-    m_rayHits.clear();
-}
\ No newline at end of file
+    m_rayEnds.clear();
+    m_rayAngles.clear();
+}
@@ -1,5 +1,7 @@
 #include "Shotgun.h"
 #include "AudioManager.h"
+#include "Profiler.h"
+#include "Random.h"
 
 //-----------------------------------------------------------------------------
 // Decreased opacity of shotgun rays, removes collision rays after 1 frame
@@ -7,33 +9,38 @@
 //-----------------------------------------------------------------------------
 void Shotgun::Update(float deltaTime)
 {
-    for (size_t i = 0; i < m_blasts.size(); i++)
+    for (int i = 0; i < m_blastCount; i++)
     {
+        int slot = GetBlastSlot(i);
+
         // Removes shotgun ray collision after 1 frame
-        if (m_blasts[i].collisionChecked)
+        if (m_blastCollisionChecked[slot])
         {
-            // Only clear collisionRays if they have not previously been cleared
-            if (!m_blasts[i].collisionRays.GetRays().empty())
-            {
-                m_blasts[i].collisionRays.ResetRays();
-            }
+            m_blastCollides[slot] = false;
         }
         else
         {
-            m_blasts[i].collisionChecked = true;
+            m_blastCollisionChecked[slot] = true;
         }
 
-        // Decreases constanly alpha, removes from vector if alpha is < 0
-        m_blasts[i].alpha -= 95.0f * deltaTime;
+        // Decreases constanly alpha
+        m_blastAlpha[slot] -= 95.0f * deltaTime;
+    }
 
-        if (m_blasts[i].alpha <= 0)
-        {
-            m_blasts.erase(m_blasts.begin() + i);
-            i--;
-        }
+    // Every blast fades at the same speed, so the oldest ones run out first
+    while (m_blastCount > 0 && m_blastAlpha[m_firstBlast] <= 0)
+    {
+        m_firstBlast = (m_firstBlast + 1) % m_MAX_BLASTS;
+        m_blastCount--;
     }
 
     // Updates ammo count text
+    PROFILE_ZONE("Shotgun::Update text");
+    if (m_currentMagAmmo == m_shownMagAmmo && m_currentReserveAmmo == m_shownReserveAmmo) return;
+
+    m_shownMagAmmo = m_currentMagAmmo;
+    m_shownReserveAmmo = m_currentReserveAmmo;
+
     char ammoText[8];
     sprintf(ammoText, "%d%c%d", m_currentMagAmmo, '/', m_currentReserveAmmo);
     m_ammoText.CreateTextTexture(ammoText, strlen(ammoText), 22.0f, { 255, 0, 0 }, Vec2(4.0f, 4.0f));
@@ -47,10 +54,13 @@ void Shotgun::Update(float deltaTime)
 void Shotgun::Render() const
 {
     // Render every line for every shotgunblast
-    for (const ShotgunBlast& blast : m_blasts)
+    for (int i = 0; i < m_blastCount; i++)
     {
-        if (blast.alpha > 0)
-            blast.rays.Render(false, 255, 0, 0, (uint8_t)blast.alpha);
+        float alpha = GetBlastAlpha(i);
+        if (alpha <= 0) continue;
+
+        for (const Primitives2D::LineSegment& pellet : GetBlastPellets(i))
+            pellet.Render(255, 0, 0, (uint8_t)alpha);
     }
 
     // Renders the ammo count
@@ -59,22 +69,47 @@ void Shotgun::Render() const
 
 
 //-----------------------------------------------------------------------------
-// Shoots m_bulletAmount rays at random spots within cursor
+// Returns the pellet rays of a blast, 0 is the oldest blast
+//-----------------------------------------------------------------------------
+std::span<const Primitives2D::LineSegment> Shotgun::GetBlastPellets(int blast) const
+{
+    return std::span<const Primitives2D::LineSegment>(&m_pellets[GetBlastSlot(blast) * m_PELLETS_PER_BLAST], m_PELLETS_PER_BLAST);
+}
+
+
+//-----------------------------------------------------------------------------
+// Shoots m_PELLETS_PER_BLAST rays at random spots within cursor, pellets
+// start at the player and stop where playerSight says they hit a wall
+// Returns false if the mag was empty
 //-----------------------------------------------------------------------------
-void Shotgun::Shoot(const std::vector<Primitives2D::Rect>& environment, const Vec2& playerPos, const Vec2& position, float radius)
+bool Shotgun::Shoot(const VisibilityPolygon& playerSight, const Vec2& position, float radius)
 {
-    if (m_currentMagAmmo <= 0) return;
+    if (m_currentMagAmmo <= 0) return false;
     m_currentMagAmmo--;
 
-    Raycast newBlast;
+    // Takes the oldest blast's place if every slot is in use
+    if (m_blastCount == m_MAX_BLASTS)
+    {
+        m_firstBlast = (m_firstBlast + 1) % m_MAX_BLASTS;
+        m_blastCount--;
+    }
+
+    int slot = GetBlastSlot(m_blastCount);
+    m_blastCount++;
+    m_blastAlpha[slot] = 255.0f;
+    m_blastCollides[slot] = true;
+    m_blastCollisionChecked[slot] = false;
+
+    RandomStream& random = Random::Get(Random::Stream::ShotgunSpread);
+    Primitives2D::LineSegment* pellets = &m_pellets[slot * m_PELLETS_PER_BLAST];
 
-    for (int i = 0; i < m_bulletAmount; i++)
+    for (int i = 0; i < m_PELLETS_PER_BLAST; i++)
     {
         // Generate random radians 0 - 2PI
-        float angle = (float)rand() / RAND_MAX * 2.0f * PI;
+        float angle = random.NextFloat() * 2.0f * PI;
 
         // Generate random distance 0 - radius
-        float distance = sqrt((float)rand() / RAND_MAX) * radius;
+        float distance = sqrt(random.NextFloat()) * radius;
 
         // Calculate bullet target pos
         Vec2 bulletPosition(
@@ -82,11 +117,11 @@ void Shotgun::Shoot(const std::vector<Primitives2D::Rect>& environment, const Ve
             position.y + distance * sin(angle)
         );
 
-        newBlast.CastRayToPos(playerPos, bulletPosition, environment, true);
+        pellets[i] = Primitives2D::LineSegment(playerSight.GetOrigin(), playerSight.GetHitPos(bulletPosition));
     }
 
-    m_blasts.emplace_back(newBlast, 255.0f);
     AudioManager::GetInstance().Play(AudioEnum::ShotgunShoot);
+    return true;
 }
 
 
@@ -0,0 +1,337 @@
+#include "StaticGrid.h"
+#include "EntityStore.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <limits>
+
+using namespace Primitives2D;
+
+//-----------------------------------------------------------------------------
+// Constructor, every list lives in memory, normally the level arena
+//-----------------------------------------------------------------------------
+StaticGrid::StaticGrid(std::pmr::memory_resource* memory)
+    : m_layers{ Layer(memory), Layer(memory), Layer(memory), Layer(memory) }
+    , m_results(memory)
+{
+    static_assert(LAYER_COUNT == 4, "Add a Layer(memory) above for every GridLayer");
+}
+
+
+//-----------------------------------------------------------------------------
+// Sizes the grid to fit every object and sorts each layer's objects into
+// the cells they touch, cells grow when the level is too big for m_MAX_CELLS
+//-----------------------------------------------------------------------------
+void StaticGrid::Build(const std::array<std::span<const Rect>, LAYER_COUNT>& layers)
+{
+    // Finds the area covered by every object
+    bool isEmpty = true;
+    Vec2 worldMin;
+    Vec2 worldMax;
+    for (std::span<const Rect> rects : layers)
+    {
+        for (const Rect& rect : rects)
+        {
+            worldMin = isEmpty ? rect.min : Vec2(std::min(worldMin.x, rect.min.x), std::min(worldMin.y, rect.min.y));
+            worldMax = isEmpty ? rect.max : Vec2(std::max(worldMax.x, rect.max.x), std::max(worldMax.y, rect.max.y));
+            isEmpty = false;
+        }
+    }
+
+    m_origin = worldMin;
+    m_cellSize = m_MIN_CELL_SIZE;
+    m_columns = 0;
+    m_rows = 0;
+    if (!isEmpty)
+    {
+        const Vec2 size = worldMax - worldMin;
+        do
+        {
+            m_columns = static_cast<int>(size.x / m_cellSize) + 1;
+            m_rows = static_cast<int>(size.y / m_cellSize) + 1;
+            if (static_cast<size_t>(m_columns) * m_rows <= m_MAX_CELLS) break;
+            m_cellSize *= 2.0f;
+        } while (true);
+    }
+
+    const size_t cellCount = static_cast<size_t>(m_columns) * m_rows;
+    m_queryStamp = 0;
+
+    for (int layerIndex = 0; layerIndex < LAYER_COUNT; layerIndex++)
+    {
+        Layer& layer = m_layers[layerIndex];
+        std::span<const Rect> rects = layers[layerIndex];
+
+        layer.bounds.assign(rects.begin(), rects.end());
+        layer.queryStamps.assign(rects.size(), 0);
+        layer.cellCount.assign(cellCount, 0);
+        layer.cellStart.assign(cellCount + 1, 0);
+
+        // Counts objects per cell, then turns the counts into start offsets
+        int minColumn, minRow, maxColumn, maxRow;
+        for (const Rect& rect : rects)
+        {
+            GetCellRange(rect, minColumn, minRow, maxColumn, maxRow);
+            for (int row = minRow; row <= maxRow; row++)
+                for (int column = minColumn; column <= maxColumn; column++)
+                    layer.cellStart[row * m_columns + column + 1]++;
+        }
+
+        for (size_t cell = 0; cell < cellCount; cell++)
+        {
+            layer.cellStart[cell + 1] += layer.cellStart[cell];
+        }
+
+        // Fills the cells, cellCount ends up as every cell's object count
+        layer.items.resize(layer.cellStart[cellCount]);
+        for (uint32_t i = 0; i < rects.size(); i++)
+        {
+            GetCellRange(rects[i], minColumn, minRow, maxColumn, maxRow);
+            for (int row = minRow; row <= maxRow; row++)
+            {
+                for (int column = minColumn; column <= maxColumn; column++)
+                {
+                    const int cell = row * m_columns + column;
+                    layer.items[layer.cellStart[cell] + layer.cellCount[cell]++] = i;
+                }
+            }
+        }
+    }
+
+    m_results.clear();
+    m_results.reserve(64);
+}
+
+
+//-----------------------------------------------------------------------------
+// Visits every cell area touches, objects in several of those cells are
+// only returned the first time thanks to the query stamps
+//-----------------------------------------------------------------------------
+std::span<const uint32_t> StaticGrid::Query(GridLayer layer, const Rect& area)
+{
+    Layer& queried = m_layers[static_cast<int>(layer)];
+    m_results.clear();
+    if (queried.bounds.empty()) return m_results;
+
+    // Stamps from before wrapping around could match again, so clear them
+    if (++m_queryStamp == 0)
+    {
+        for (Layer& each : m_layers)
+            std::fill(each.queryStamps.begin(), each.queryStamps.end(), 0);
+        m_queryStamp = 1;
+    }
+
+    int minColumn, minRow, maxColumn, maxRow;
+    GetCellRange(area, minColumn, minRow, maxColumn, maxRow);
+
+    for (int row = minRow; row <= maxRow; row++)
+    {
+        for (int column = minColumn; column <= maxColumn; column++)
+        {
+            const int cell = row * m_columns + column;
+            const uint32_t start = queried.cellStart[cell];
+            const uint32_t end = start + queried.cellCount[cell];
+
+            for (uint32_t entry = start; entry < end; entry++)
+            {
+                const uint32_t index = queried.items[entry];
+                if (queried.queryStamps[index] == m_queryStamp) continue;
+                queried.queryStamps[index] = m_queryStamp;
+
+                if (CheckRectRectCollision(queried.bounds[index], area))
+                    m_results.push_back(index);
+            }
+        }
+    }
+
+    return m_results;
+}
+
+
+//-----------------------------------------------------------------------------
+// Clips the ray to the grid, then walks its cells one column or row at a
+// time, whichever border the ray crosses first, and stops once the closest
+// hit so far is before the next cell
+//-----------------------------------------------------------------------------
+bool StaticGrid::CastRay(GridLayer layer, const Vec2& origin, const Vec2& rayEnd, Vec2& hit)
+{
+    Layer& queried = m_layers[static_cast<int>(layer)];
+    if (queried.bounds.empty()) return false;
+
+    // How far along the ray, 0 to 1, it enters and leaves the grid
+    const Vec2 direction = rayEnd - origin;
+    float gridEnter = 0.0f;
+    float gridExit = 1.0f;
+    auto clip = [&](float start, float delta, float min, float max)
+    {
+        if (delta == 0.0f) return start >= min && start <= max;
+
+        float slabEnter = (min - start) / delta;
+        float slabExit = (max - start) / delta;
+        if (slabEnter > slabExit) std::swap(slabEnter, slabExit);
+
+        gridEnter = std::max(gridEnter, slabEnter);
+        gridExit = std::min(gridExit, slabExit);
+        return gridEnter <= gridExit;
+    };
+
+    const Vec2 gridMax = m_origin + Vec2(m_columns * m_cellSize, m_rows * m_cellSize);
+    if (!clip(origin.x, direction.x, m_origin.x, gridMax.x) || !clip(origin.y, direction.y, m_origin.y, gridMax.y))
+        return false;
+
+    // A one point area gets the cell a point is in, clamped to the grid
+    int column, row, endColumn, endRow, unused;
+    const Vec2 enterPos = origin + direction * gridEnter;
+    const Vec2 exitPos = origin + direction * gridExit;
+    GetCellRange(Rect(enterPos, 0.0f, 0.0f), column, row, unused, unused);
+    GetCellRange(Rect(exitPos, 0.0f, 0.0f), endColumn, endRow, unused, unused);
+
+    const int columnStep = endColumn > column ? 1 : -1;
+    const int rowStep = endRow > row ? 1 : -1;
+    const float infinity = std::numeric_limits<float>::infinity();
+    const float columnDelta = direction.x != 0.0f ? m_cellSize / std::abs(direction.x) : infinity;
+    const float rowDelta = direction.y != 0.0f ? m_cellSize / std::abs(direction.y) : infinity;
+    float nextColumn = direction.x != 0.0f ? (m_origin.x + (column + (direction.x > 0.0f ? 1 : 0)) * m_cellSize - origin.x) / direction.x : infinity;
+    float nextRow = direction.y != 0.0f ? (m_origin.y + (row + (direction.y > 0.0f ? 1 : 0)) * m_cellSize - origin.y) / direction.y : infinity;
+
+    if (++m_queryStamp == 0)
+    {
+        for (Layer& each : m_layers)
+            std::fill(each.queryStamps.begin(), each.queryStamps.end(), 0);
+        m_queryStamp = 1;
+    }
+
+    const LineSegment ray(origin, rayEnd);
+    const float rayLength = direction.Length();
+    float closestDistance = infinity;
+    uint32_t rectTests = 0;
+
+    // Always ends in the end cell, even if rounding picks the wrong border
+    const int steps = std::abs(endColumn - column) + std::abs(endRow - row);
+    for (int step = 0; step <= steps; step++)
+    {
+        const int cell = row * m_columns + column;
+        const uint32_t start = queried.cellStart[cell];
+        const uint32_t end = start + queried.cellCount[cell];
+
+        for (uint32_t entry = start; entry < end; entry++)
+        {
+            const uint32_t index = queried.items[entry];
+            if (queried.queryStamps[index] == m_queryStamp) continue;
+            queried.queryStamps[index] = m_queryStamp;
+
+            rectTests++;
+            Intersect intersection = CheckLineRectCollision(ray, queried.bounds[index]);
+            if (!intersection.result) continue;
+
+            const float distance = (intersection.pos - origin).Length();
+            if (distance < closestDistance)
+            {
+                closestDistance = distance;
+                hit = intersection.pos;
+            }
+        }
+
+        // Nothing in a later cell can be closer than a hit before this cell ends
+        if (closestDistance <= std::min(nextColumn, nextRow) * rayLength) break;
+
+        if (column != endColumn && (row == endRow || nextColumn < nextRow))
+        {
+            column += columnStep;
+            nextColumn += columnDelta;
+        }
+        else
+        {
+            row += rowStep;
+            nextRow += rowDelta;
+        }
+    }
+
+    Metrics::GetInstance().Add(MetricCounter::RectTests, rectTests);
+    return closestDistance != infinity;
+}
+
+
+//-----------------------------------------------------------------------------
+// Removes object index, the last object is renamed to index so the grid
+// matches the list after SwapAndPop was called on it
+//-----------------------------------------------------------------------------
+void StaticGrid::SwapAndPop(GridLayer layer, uint32_t index)
+{
+    Layer& changed = m_layers[static_cast<int>(layer)];
+    const uint32_t last = static_cast<uint32_t>(changed.bounds.size() - 1);
+
+    RemoveFromCells(changed, index);
+    if (index != last)
+        RenameInCells(changed, last, index);
+
+    ::SwapAndPop(changed.bounds, index);
+    ::SwapAndPop(changed.queryStamps, index);
+}
+
+
+//-----------------------------------------------------------------------------
+// Gets the cells area touches, clamped to the grid so areas outside of it
+// still visit the cells at its edge
+//-----------------------------------------------------------------------------
+void StaticGrid::GetCellRange(const Rect& area, int& minColumn, int& minRow, int& maxColumn, int& maxRow) const
+{
+    auto toCell = [this](float position, float origin, int cells)
+    {
+        const float cell = std::floor((position - origin) / m_cellSize);
+        return static_cast<int>(std::clamp(cell, 0.0f, static_cast<float>(cells - 1)));
+    };
+
+    minColumn = toCell(area.min.x, m_origin.x, m_columns);
+    maxColumn = toCell(area.max.x, m_origin.x, m_columns);
+    minRow = toCell(area.min.y, m_origin.y, m_rows);
+    maxRow = toCell(area.max.y, m_origin.y, m_rows);
+}
+
+
+//-----------------------------------------------------------------------------
+// Takes index out of every cell it's in, the cell's last object fills the gap
+//-----------------------------------------------------------------------------
+void StaticGrid::RemoveFromCells(Layer& layer, uint32_t index)
+{
+    int minColumn, minRow, maxColumn, maxRow;
+    GetCellRange(layer.bounds[index], minColumn, minRow, maxColumn, maxRow);
+
+    for (int row = minRow; row <= maxRow; row++)
+    {
+        for (int column = minColumn; column <= maxColumn; column++)
+        {
+            const int cell = row * m_columns + column;
+            uint32_t* items = &layer.items[layer.cellStart[cell]];
+            uint32_t& count = layer.cellCount[cell];
+
+            for (uint32_t i = 0; i < count; i++)
+            {
+                if (items[i] != index) continue;
+                items[i] = items[--count];
+                break;
+            }
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Changes index from to index to in every cell from is in
+//-----------------------------------------------------------------------------
+void StaticGrid::RenameInCells(Layer& layer, uint32_t from, uint32_t to)
+{
+    int minColumn, minRow, maxColumn, maxRow;
+    GetCellRange(layer.bounds[from], minColumn, minRow, maxColumn, maxRow);
+
+    for (int row = minRow; row <= maxRow; row++)
+    {
+        for (int column = minColumn; column <= maxColumn; column++)
+        {
+            const int cell = row * m_columns + column;
+            uint32_t* items = &layer.items[layer.cellStart[cell]];
+            const uint32_t count = layer.cellCount[cell];
+
+            std::replace(items, items + count, from, to);
+        }
+    }
+}
@@ -1,5 +1,6 @@
 #include "Text.h"
 #include "RendererManager.h"
+#include "Metrics.h"
 #include <iostream>
 
 // Initialize static member
@@ -58,6 +59,7 @@ void Text::RenderTexture() const
     SDL_FRect rect = { m_position.x, m_position.y, m_dimensions.x, m_dimensions.y };
 
     // Attempts to render the text texture
+    Metrics::GetInstance().Add(MetricCounter::DrawCalls);
     if (!SDL_RenderTexture(RendererManager::GetInstance().GetRenderer(), m_texture, nullptr, &rect))
     {
         std::cerr << "SDL_RenderTexture for Text failed! Error: " << SDL_GetError() << '\n';
@@ -146,5 +148,7 @@ bool Text::CreateTextTexture(const char* text, size_t length, float ptsize, cons
     m_dimensions = Vec2(width, height);
     m_texture = textTexture;
     m_position = position;
+
+    Metrics::GetInstance().Add(MetricCounter::TextTexturesCreated);
     return true;
 }
\ No newline at end of file
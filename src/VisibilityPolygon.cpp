@@ -0,0 +1,386 @@
+#include "VisibilityPolygon.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+using namespace Primitives2D;
+
+//-----------------------------------------------------------------------------
+// Collects the outline of all walls, every wall edge without the parts
+// another wall covers, so edges never cross and only meet at their ends
+// Edges two walls share are kept once, levelGrid has to be built from walls
+//-----------------------------------------------------------------------------
+void VisibilityPolygon::SetWalls(std::span<const Rect> walls, StaticGrid& levelGrid)
+{
+    PROFILE_ZONE("VisibilityPolygon::SetWalls");
+
+    m_edges.clear();
+    m_edges.reserve(walls.size() * 4);
+    std::vector<std::pair<float, float>> covered;
+
+    for (uint32_t i = 0; i < walls.size(); i++)
+    {
+        const Rect& wall = walls[i];
+
+        // Left, right, top and bottom edge, the left and top edges face
+        // towards smaller coordinates
+        for (int side = 0; side < 4; side++)
+        {
+            const bool isVertical = side < 2;
+            const bool facesMin = side % 2 == 0;
+            const float line = isVertical ? (facesMin ? wall.min.x : wall.max.x) : (facesMin ? wall.min.y : wall.max.y);
+            const float low = isVertical ? wall.min.y : wall.min.x;
+            const float high = isVertical ? wall.max.y : wall.max.x;
+
+            covered.clear();
+            for (uint32_t other : levelGrid.Query(GridLayer::Walls, wall))
+            {
+                if (other == i) continue;
+
+                const Rect& otherWall = walls[other];
+                const float otherMin = isVertical ? otherWall.min.x : otherWall.min.y;
+                const float otherMax = isVertical ? otherWall.max.x : otherWall.max.y;
+
+                // Covered if the other wall fills the space just outside the
+                // edge, or has the same edge and comes first
+                const bool fillsOutside = facesMin ? otherMin < line && otherMax >= line : otherMax > line && otherMin <= line;
+                const bool sharesEdge = (facesMin ? otherMin : otherMax) == line && other < i;
+                if (!fillsOutside && !sharesEdge) continue;
+
+                const float otherLow = std::max(isVertical ? otherWall.min.y : otherWall.min.x, low);
+                const float otherHigh = std::min(isVertical ? otherWall.max.y : otherWall.max.x, high);
+                if (otherLow < otherHigh) covered.emplace_back(otherLow, otherHigh);
+            }
+
+            std::sort(covered.begin(), covered.end());
+
+            // Adds every uncovered part, running so the wall is on the left
+            float partStart = low;
+            auto addPart = [&](float partEnd)
+            {
+                if (partEnd <= partStart) return;
+
+                const Vec2 first = isVertical ? Vec2(line, partStart) : Vec2(partStart, line);
+                const Vec2 second = isVertical ? Vec2(line, partEnd) : Vec2(partEnd, line);
+                const bool isForward = isVertical ? facesMin : !facesMin;
+                m_edges.push_back(isForward ? Edge{ first, second } : Edge{ second, first });
+            };
+
+            for (const auto& [coveredStart, coveredEnd] : covered)
+            {
+                addPart(coveredStart);
+                partStart = std::max(partStart, coveredEnd);
+            }
+            addPart(high);
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Sweeps a ray from -PI to PI around origin, the edges facing origin start
+// and stop being crossed by it at their ends, a point is added wherever the
+// closest of the crossed edges changes, on both the old and the new one
+//-----------------------------------------------------------------------------
+void VisibilityPolygon::Build(const Vec2& origin)
+{
+    PROFILE_ZONE("VisibilityPolygon::Build");
+
+    m_origin = origin;
+    m_angles.clear();
+    m_points.clear();
+    m_segments.clear();
+    m_events.clear();
+
+    for (const Edge& edge : m_edges)
+    {
+        const Vec2 start = edge.start - origin;
+        const Vec2 end = edge.end - origin;
+        if (Vec2::Cross(end - start, Vec2::Zero() - start) <= 0.0f) continue;
+
+        // Edges crossing the ray at PI are split there so no segment wraps
+        // around, only vertical edges left of origin can cross it
+        if (start.x == end.x && start.x < 0.0f && std::min(start.y, end.y) <= 0.0f && std::max(start.y, end.y) >= 0.0f)
+        {
+            const Vec2 top = start.y < end.y ? start : end;
+            const Vec2 bottom = start.y < end.y ? end : start;
+            const Vec2 cut(start.x, 0.0f);
+
+            if (top.y < 0.0f) AddSegment(cut, top, -m_SWEEP_HALF_TURN, GetSweepAngle(top));
+            if (bottom.y > 0.0f) AddSegment(bottom, cut, GetSweepAngle(bottom), m_SWEEP_HALF_TURN);
+            continue;
+        }
+
+        const float startAngle = GetSweepAngle(start);
+        const float endAngle = GetSweepAngle(end);
+        if (startAngle < endAngle) AddSegment(start, end, startAngle, endAngle);
+        else if (endAngle < startAngle) AddSegment(end, start, endAngle, startAngle);
+    }
+
+    // Segments stop being crossed before others start at the same angle
+    std::sort(m_events.begin(), m_events.end(), [](const SweepEvent& a, const SweepEvent& b) { return a.key < b.key; });
+
+    m_activeNodes.resize(m_segments.size());
+    int openRay = 0;
+
+    // Open rays only add points where no segment is crossed
+    auto addOpenRays = [&](float untilSweepAngle)
+    {
+        for (; openRay < m_OPEN_RAYS; openRay++)
+        {
+            const float angle = -PI + 2.0f * PI * openRay / m_OPEN_RAYS;
+            const Vec2 direction(cos(angle), sin(angle));
+            const float sweepAngle = openRay == 0 ? -m_SWEEP_HALF_TURN : GetSweepAngle(direction);
+            if (sweepAngle >= untilSweepAngle) break;
+            if (m_active.empty()) AddPoint(angle, direction * m_RAY_LENGTH);
+        }
+    };
+
+    for (size_t first = 0; first < m_events.size();)
+    {
+        const float sweepAngle = GetEventAngle(m_events[first]);
+        const SweepSegment& eventSegment = m_segments[m_events[first].GetSegment()];
+        const Vec2 direction = m_events[first].IsEnd() ? eventSegment.end : eventSegment.start;
+        addOpenRays(sweepAngle);
+
+        const uint32_t closestBefore = m_active.empty() ? m_NO_SEGMENT : m_active.begin()->index;
+
+        for (; first < m_events.size() && GetEventAngle(m_events[first]) == sweepAngle; first++)
+        {
+            const uint32_t segment = m_events[first].GetSegment();
+            if (m_events[first].IsEnd())
+            {
+                m_spareNodes.push_back({ m_active.extract(m_activeNodes[segment]) });
+            }
+            else if (m_spareNodes.empty())
+            {
+                m_activeNodes[segment] = m_active.insert(m_segments[segment]).first;
+            }
+            else
+            {
+                ActiveSegments::node_type node = std::move(m_spareNodes.back().node);
+                m_spareNodes.pop_back();
+                node.value() = m_segments[segment];
+                m_activeNodes[segment] = m_active.insert(std::move(node)).position;
+            }
+        }
+
+        const uint32_t closestAfter = m_active.empty() ? m_NO_SEGMENT : m_active.begin()->index;
+        if (closestAfter == closestBefore) continue;
+
+        const bool isSweepStart = sweepAngle == -m_SWEEP_HALF_TURN;
+        const bool isSweepEnd = sweepAngle == m_SWEEP_HALF_TURN;
+        const float angle = isSweepStart ? -PI : (isSweepEnd ? PI : std::atan2(direction.y, direction.x));
+        const Vec2 hitBefore = GetSweepHit(closestBefore, sweepAngle, direction);
+        const Vec2 hitAfter = GetSweepHit(closestAfter, sweepAngle, direction);
+
+        // Segments split at PI continue each other, so the sweep neither
+        // starts nor ends with an open ray there
+        if (!isSweepStart) AddPoint(angle, hitBefore);
+        if (!isSweepEnd && (isSweepStart || hitAfter != hitBefore))
+        {
+            // Sorted right after the point it cuts off, so the edge
+            // between them points straight at origin
+            AddPoint(isSweepStart ? angle : std::nextafter(angle, PI), hitAfter);
+        }
+    }
+
+    addOpenRays(m_SWEEP_HALF_TURN);
+
+    // Every segment has ended, this only catches a sweep that went wrong
+    while (!m_active.empty())
+    {
+        m_spareNodes.push_back({ m_active.extract(m_active.begin()) });
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Point is visible if it's on the same side as origin of the polygon edge
+// at its angle
+//-----------------------------------------------------------------------------
+bool VisibilityPolygon::IsVisible(const Vec2& point) const
+{
+    if (m_points.size() < 2) return true;
+
+    const Vec2 toPoint = point - m_origin;
+    if (toPoint.LengthSquared() < 0.001f) return true;
+
+    size_t first, second;
+    GetEdge(toPoint, first, second);
+
+    const Vec2 edgeStart = m_points[first];
+    const Vec2 edge = m_points[second] - edgeStart;
+    const float originSide = Vec2::Cross(edge, m_origin - edgeStart);
+    const float pointSide = Vec2::Cross(edge, point - edgeStart);
+
+    // Edge points straight at origin, only happens when both rays stopped
+    // at the same angle, so compare distances instead
+    if (std::abs(originSide) < 0.001f)
+    {
+        const float reach = std::max((m_points[first] - m_origin).LengthSquared(), (m_points[second] - m_origin).LengthSquared());
+        return toPoint.LengthSquared() <= reach;
+    }
+
+    return originSide > 0.0f ? pointSide >= 0.0f : pointSide <= 0.0f;
+}
+
+
+//-----------------------------------------------------------------------------
+// Intersects the ray towards target with the polygon edge at its angle
+//-----------------------------------------------------------------------------
+Vec2 VisibilityPolygon::GetHitPos(const Vec2& target) const
+{
+    Vec2 direction = target - m_origin;
+    if (direction.LengthSquared() < 0.001f) direction = Vec2(1.0f, 0.0f);
+    direction.Normalize();
+
+    if (m_points.size() < 2) return m_origin + direction * m_RAY_LENGTH;
+
+    size_t first, second;
+    GetEdge(direction, first, second);
+
+    const Vec2 edgeStart = m_points[first];
+    const Vec2 edge = m_points[second] - edgeStart;
+    const float denominator = Vec2::Cross(direction, edge);
+
+    // Ray runs along the edge, the closer end is where it stops
+    if (std::abs(denominator) < 0.0001f)
+    {
+        const float firstDistance = (m_points[first] - m_origin).LengthSquared();
+        const float secondDistance = (m_points[second] - m_origin).LengthSquared();
+        return firstDistance < secondDistance ? m_points[first] : m_points[second];
+    }
+
+    const float distance = Vec2::Cross(edgeStart - m_origin, edge) / denominator;
+    return m_origin + direction * std::max(distance, 0.0f);
+}
+
+
+//-----------------------------------------------------------------------------
+// Adds a segment relative to origin, startAngle is the smaller angle
+//-----------------------------------------------------------------------------
+void VisibilityPolygon::AddSegment(const Vec2& start, const Vec2& end, float startAngle, float endAngle)
+{
+    const uint32_t index = static_cast<uint32_t>(m_segments.size());
+    m_segments.push_back({ start, end, startAngle, endAngle, index });
+
+    // Flips the bits of negative angles and the sign bit of the others, so
+    // the angles sort as integers, adding 0 turns -0 into 0
+    auto getAngleBits = [](float angle)
+    {
+        const uint32_t bits = std::bit_cast<uint32_t>(angle + 0.0f);
+        return static_cast<uint64_t>((bits & 0x80000000) ? ~bits : bits | 0x80000000) << 32;
+    };
+
+    m_events.push_back({ getAngleBits(startAngle) | 0x80000000 | index });
+    m_events.push_back({ getAngleBits(endAngle) | index });
+}
+
+
+//-----------------------------------------------------------------------------
+// Gets the sweep angle of the end of the segment event is about
+//-----------------------------------------------------------------------------
+float VisibilityPolygon::GetEventAngle(const SweepEvent& event) const
+{
+    const SweepSegment& segment = m_segments[event.GetSegment()];
+    return event.IsEnd() ? segment.endAngle : segment.startAngle;
+}
+
+
+//-----------------------------------------------------------------------------
+// Adds an outline point, relativePosition is relative to origin, angles
+// of points at nearly the same angle can round the wrong way, so they are
+// kept sorted
+//-----------------------------------------------------------------------------
+void VisibilityPolygon::AddPoint(float angle, const Vec2& relativePosition)
+{
+    m_angles.push_back(m_angles.empty() ? angle : std::max(angle, m_angles.back()));
+    m_points.push_back(m_origin + relativePosition);
+}
+
+
+//-----------------------------------------------------------------------------
+// Where the ray towards direction, at sweepAngle, crosses segment, relative
+// to origin, ends are returned as they are so neighbouring segments meet
+// exactly, m_NO_SEGMENT is a ray that hits nothing
+//-----------------------------------------------------------------------------
+Vec2 VisibilityPolygon::GetSweepHit(uint32_t segment, float sweepAngle, const Vec2& direction) const
+{
+    if (segment == m_NO_SEGMENT) return direction.Normalized() * m_RAY_LENGTH;
+
+    const SweepSegment& hit = m_segments[segment];
+    if (sweepAngle == hit.startAngle) return hit.start;
+    if (sweepAngle == hit.endAngle) return hit.end;
+
+    return direction * static_cast<float>(GetDistance(hit, direction.x, direction.y));
+}
+
+
+//-----------------------------------------------------------------------------
+// Orders directions the same way atan2 does without any trig, from -2 to
+// 2 instead of -PI to PI, x and y can't both be 0
+//-----------------------------------------------------------------------------
+float VisibilityPolygon::GetSweepAngle(const Vec2& direction)
+{
+    const float diagonal = std::abs(direction.x) + std::abs(direction.y);
+    if (direction.x >= 0.0f) return direction.y / diagonal;
+
+    return direction.y >= 0.0f ? 1.0f - direction.x / diagonal : -1.0f + direction.x / diagonal;
+}
+
+
+//-----------------------------------------------------------------------------
+// How far along direction the line of segment is, in units of the length
+// of direction, in double since segments can be far away and nearly parallel
+//-----------------------------------------------------------------------------
+double VisibilityPolygon::GetDistance(const SweepSegment& segment, double directionX, double directionY)
+{
+    const double edgeX = static_cast<double>(segment.end.x) - segment.start.x;
+    const double edgeY = static_cast<double>(segment.end.y) - segment.start.y;
+
+    const double denominator = directionX * edgeY - directionY * edgeX;
+    if (std::abs(denominator) < 1e-12) return std::min(segment.start.Length(), segment.end.Length());
+
+    return (segment.start.x * edgeY - segment.start.y * edgeX) / denominator;
+}
+
+
+//-----------------------------------------------------------------------------
+// Both segments are crossed by the current ray, a new one may only start
+// at it, so they are compared along the ray halfway through the angles
+// they share, between the later start and the earlier end
+//-----------------------------------------------------------------------------
+bool VisibilityPolygon::IsCloser::operator()(const SweepSegment& a, const SweepSegment& b) const
+{
+    if (a.index == b.index) return false;
+
+    const Vec2& shareStart = a.startAngle > b.startAngle ? a.start : b.start;
+    const Vec2& shareEnd = a.endAngle < b.endAngle ? a.end : b.end;
+    const double startLength = shareStart.Length();
+    const double endLength = shareEnd.Length();
+    const double directionX = shareStart.x / startLength + shareEnd.x / endLength;
+    const double directionY = shareStart.y / startLength + shareEnd.y / endLength;
+
+    const double distanceA = GetDistance(a, directionX, directionY);
+    const double distanceB = GetDistance(b, directionX, directionY);
+
+    return distanceA != distanceB ? distanceA < distanceB : a.index < b.index;
+}
+
+
+//-----------------------------------------------------------------------------
+// Finds the two neighbouring polygon points on either side of the angle
+// of direction, wraps around from the last point to the first
+// Takes a direction, not a point, since the angle offsets are too small to
+// survive adding and then subtracting origin again
+//-----------------------------------------------------------------------------
+void VisibilityPolygon::GetEdge(const Vec2& direction, size_t& first, size_t& second) const
+{
+    const float angle = atan2(direction.y, direction.x);
+
+    const size_t after = std::upper_bound(m_angles.begin(), m_angles.end(), angle) - m_angles.begin();
+    first = (after == 0) ? m_points.size() - 1 : after - 1;
+    second = (first + 1) % m_points.size();
+}
@@ -0,0 +1,217 @@
+#include "WorldState.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+namespace
+{
+    //-----------------------------------------------------------------------------
+    // Writes/reads a single value
+    //-----------------------------------------------------------------------------
+    template <typename T>
+    bool Write(FILE* file, const T& value) { return fwrite(&value, sizeof(T), 1, file) == 1; }
+
+    template <typename T>
+    bool Read(FILE* file, T& value) { return fread(&value, sizeof(T), 1, file) == 1; }
+}
+
+
+//-----------------------------------------------------------------------------
+// Checks if a game object has been picked up or killed, what LoadLevel
+// asks for every object in a level
+//-----------------------------------------------------------------------------
+bool WorldState::Contains(uint16_t levelID, GameObjects::GameObjectsEnum type, uint32_t ID) const
+{
+    if (m_count == 0) return false;
+
+    const uint64_t key = MakeKey(levelID, type, ID);
+    const size_t mask = m_slots.size() - 1;
+
+    for (size_t i = Hash(key) & mask; m_slots[i] != m_EMPTY; i = (i + 1) & mask)
+    {
+        if (m_slots[i] == key) return true;
+    }
+
+    return false;
+}
+
+
+//-----------------------------------------------------------------------------
+// Marks a game object as picked up or killed
+//-----------------------------------------------------------------------------
+void WorldState::Insert(uint16_t levelID, GameObjects::GameObjectsEnum type, uint32_t ID)
+{
+    InsertKey(MakeKey(levelID, type, ID));
+}
+
+
+//-----------------------------------------------------------------------------
+// Forgets everything, keeps the memory for the next run
+//-----------------------------------------------------------------------------
+void WorldState::Clear()
+{
+    std::fill(m_slots.begin(), m_slots.end(), m_EMPTY);
+    m_count = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Writes the current level and every key, sorted, to a binary file
+//-----------------------------------------------------------------------------
+bool WorldState::Save(const char* filepath, uint16_t currentLevelID) const
+{
+    std::vector<uint64_t> keys;
+    keys.reserve(m_count);
+    for (uint64_t key : m_slots)
+    {
+        if (key != m_EMPTY) keys.push_back(key);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    FILE* file = fopen(filepath, "wb");
+    if (file == nullptr)
+    {
+        std::cerr << "Failed to open " << filepath << " for writing save!" << '\n';
+        return false;
+    }
+
+    // Header is 16 bytes so the keys stay 8 byte aligned when mapped
+    const uint16_t padding = 0;
+    bool ok = Write(file, m_MAGIC) && Write(file, m_VERSION)
+        && Write(file, currentLevelID) && Write(file, padding)
+        && Write(file, static_cast<uint32_t>(keys.size()))
+        && fwrite(keys.data(), sizeof(uint64_t), keys.size(), file) == keys.size();
+
+    fclose(file);
+
+    if (!ok)
+    {
+        std::cerr << "Failed to write save to " << filepath << '\n';
+        return false;
+    }
+
+    std::cout << "Saved " << keys.size() << " collected objects to " << filepath << '\n';
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Reads a save written by Save(), leaves the state empty if it fails
+//-----------------------------------------------------------------------------
+bool WorldState::Load(const char* filepath, uint16_t& currentLevelID)
+{
+    Clear();
+
+    FILE* file = fopen(filepath, "rb");
+    if (file == nullptr) return false;
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint16_t levelID = 0;
+    uint16_t padding = 0;
+    uint32_t keyCount = 0;
+    bool ok = Read(file, magic) && Read(file, version)
+        && Read(file, levelID) && Read(file, padding)
+        && Read(file, keyCount);
+
+    if (!ok || magic != m_MAGIC || version != m_VERSION)
+    {
+        std::cerr << filepath << " is not a supported save!" << '\n';
+        fclose(file);
+        return false;
+    }
+
+    // Count comes from the file, so check it fits before allocating for it
+    const long keysStart = ftell(file);
+    fseek(file, 0, SEEK_END);
+    const long fileSize = ftell(file);
+    fseek(file, keysStart, SEEK_SET);
+    if (keysStart < 0 || fileSize < keysStart || keyCount > static_cast<uint64_t>(fileSize - keysStart) / sizeof(uint64_t))
+    {
+        std::cerr << "Save " << filepath << " is truncated!" << '\n';
+        fclose(file);
+        return false;
+    }
+
+    std::vector<uint64_t> keys(keyCount);
+    ok = fread(keys.data(), sizeof(uint64_t), keyCount, file) == keyCount;
+    fclose(file);
+
+    if (!ok)
+    {
+        std::cerr << "Save " << filepath << " is truncated!" << '\n';
+        return false;
+    }
+
+    // m_EMPTY marks a free slot, so it can't be stored as a key
+    if (std::find(keys.begin(), keys.end(), m_EMPTY) != keys.end())
+    {
+        std::cerr << "Save " << filepath << " is corrupted!" << '\n';
+        return false;
+    }
+
+    for (uint64_t key : keys) InsertKey(key);
+    currentLevelID = levelID;
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Packs level, type and ID into one key, keys are stored with level 0
+//-----------------------------------------------------------------------------
+uint64_t WorldState::MakeKey(uint16_t levelID, GameObjects::GameObjectsEnum type, uint32_t ID)
+{
+    if (type == GameObjects::GameObjectsEnum::Keys) levelID = 0;
+
+    return (static_cast<uint64_t>(levelID) << 48) | (static_cast<uint64_t>(type) << 32) | ID;
+}
+
+
+//-----------------------------------------------------------------------------
+// Mixes every bit of the key, IDs are often consecutive which
+// would otherwise fill neighbouring slots
+//-----------------------------------------------------------------------------
+size_t WorldState::Hash(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return static_cast<size_t>(key);
+}
+
+
+//-----------------------------------------------------------------------------
+// Adds a key if it isn't already in the set
+//-----------------------------------------------------------------------------
+void WorldState::InsertKey(uint64_t key)
+{
+    if ((m_count + 1) * 2 > m_slots.size()) Grow();
+
+    const size_t mask = m_slots.size() - 1;
+    size_t i = Hash(key) & mask;
+    for (; m_slots[i] != m_EMPTY; i = (i + 1) & mask)
+    {
+        if (m_slots[i] == key) return;
+    }
+
+    m_slots[i] = key;
+    m_count++;
+}
+
+
+//-----------------------------------------------------------------------------
+// Doubles capacity and reinserts every key
+//-----------------------------------------------------------------------------
+void WorldState::Grow()
+{
+    std::vector<uint64_t> oldSlots(std::max(m_slots.size() * 2, m_MIN_CAPACITY), m_EMPTY);
+    oldSlots.swap(m_slots);
+    m_count = 0;
+
+    for (uint64_t key : oldSlots)
+    {
+        if (key != m_EMPTY) InsertKey(key);
+    }
+}
@@ -1,13 +1,62 @@
 #include "Game.h"
+#include <cstring>
 
 int main(int argc, char* argv[])
 {
-	Game* game = new Game();
+	// --record <file> saves input on exit, --replay <file> replays it headless
+	// and checks every frame against the recorded checksums
+	// --level <id> starts at another level than the main menu, e.g. a generated one
+	LaunchOptions options;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+		{
+			options.mode = RunMode::Record;
+			options.recordingPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+		{
+			options.mode = RunMode::Replay;
+			options.recordingPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--level") == 0 && i + 1 < argc)
+		{
+			options.startLevelID = static_cast<uint16_t>(atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--alloc-check") == 0 && i + 1 < argc)
+		{
+			options.mode = RunMode::AllocCheck;
+			options.startLevelID = static_cast<uint16_t>(atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc)
+		{
+			options.savePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc)
+		{
+			options.metricsPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			options.hasSeed = true;
+			options.seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--record <file> | --replay <file>] [--seed <number>] [--level <id>] [--save <file>] [--metrics <file.csv>] [--alloc-check <level>]" << '\n';
+			return 1;
+		}
+	}
+
+	Game* game = new Game(options);
 
 	while (game->Running())
 	{
 		game->Update();
 	}
 
+	int exitCode = game->GetExitCode();
 	delete game;
+
+	return exitCode;
 }
@@ -0,0 +1,526 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Writes stress test levels in the same json format Game::LoadLevel reads
+// Usage: LevelGenerator [options], see PrintUsage()
+
+namespace
+{
+    // Same as Settings.h, the game doesn't scroll so every level fills one screen
+    constexpr int WINDOW_WIDTH = 1920;
+    constexpr int WINDOW_HEIGHT = 1080;
+
+    constexpr int BORDER_THICKNESS = 25;
+    constexpr int DOOR_START = 465;
+    constexpr int DOOR_END = 615;
+
+    // Players enter levels 50 pixels from the screen edge and start level 1 in
+    // the middle of the screen, walls are kept out of these areas
+    constexpr int EDGE_CLEARANCE = 100;
+    constexpr float CENTER_CLEARANCE = 150.0f;
+    constexpr float ENEMY_CENTER_CLEARANCE = 300.0f;
+
+    // Same as the game, largest enemy hitbox and pickup bounds, used to keep
+    // enemies and pickups out of walls
+    constexpr int ENEMY_RADIUS = 25;
+    constexpr int AMMO_CRATE_WIDTH = 42;
+    constexpr int AMMO_CRATE_HEIGHT = 32;
+    constexpr int KEY_SIZE = 32;
+
+    // Random spots tried per enemy or pickup before giving up on it
+    constexpr int MAX_PLACEMENT_ATTEMPTS = 10000;
+
+    enum class Layout
+    {
+        Scatter, // Randomly placed and sized blocks
+        Grid,    // Evenly spaced pillars
+        Rooms    // Grid of rooms with a doorway in every wall
+    };
+
+    struct Options
+    {
+        int wallCount = 1000;
+        int enemyCount = 10;
+        int ammoCrateCount = 2;
+        int keyCount = 1;
+        int levelID = 100;
+        int nextLevelID = 1;
+        int idBase = -1; // Defaults to levelID * 100 like the shipped levels
+        uint32_t seed = 1;
+        Layout layout = Layout::Scatter;
+        std::string enemyType = "Fast";
+        std::string outputPath;
+    };
+
+    struct LevelRect
+    {
+        int x, y, width, height;
+    };
+
+    struct Level
+    {
+        std::vector<LevelRect> walls;
+        std::vector<LevelRect> enemyPaths; // x, y is path start, width, height is path end
+        std::vector<LevelRect> ammoCrates; // Only x, y is used
+        std::vector<LevelRect> keys;       // Only x, y is used
+    };
+
+    //-----------------------------------------------------------------------------
+    // Prints every option and its default
+    //-----------------------------------------------------------------------------
+    void PrintUsage(const char* program)
+    {
+        std::cerr << "Usage: " << program << " [options]\n"
+            << "  --walls N          Walls, including the 5 border walls (1000)\n"
+            << "  --enemies N        Enemies (10)\n"
+            << "  --ammo N           Ammo crates (2)\n"
+            << "  --keys N           Keys, the exit needs the first one (1)\n"
+            << "  --layout NAME      scatter, grid or rooms (scatter)\n"
+            << "  --enemy-type NAME  Fast, Brute, Boss or Tutorial (Fast)\n"
+            << "  --level-id N       ID of the generated level (100)\n"
+            << "  --next-level N     Level the exit leads to (1)\n"
+            << "  --id-base N        First object ID (level-id * 100)\n"
+            << "  --seed N           Random seed (1)\n"
+            << "  --output PATH      Output file (level_<level-id>.json)\n";
+    }
+
+    //-----------------------------------------------------------------------------
+    // Parses command line, returns false on unknown or invalid arguments
+    //-----------------------------------------------------------------------------
+    bool ParseOptions(int argc, char* argv[], Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            if (i + 1 >= argc) return false;
+
+            const char* name = argv[i];
+            const char* value = argv[++i];
+
+            if      (strcmp(name, "--walls") == 0)      options.wallCount = atoi(value);
+            else if (strcmp(name, "--enemies") == 0)    options.enemyCount = atoi(value);
+            else if (strcmp(name, "--ammo") == 0)       options.ammoCrateCount = atoi(value);
+            else if (strcmp(name, "--keys") == 0)       options.keyCount = atoi(value);
+            else if (strcmp(name, "--level-id") == 0)   options.levelID = atoi(value);
+            else if (strcmp(name, "--next-level") == 0) options.nextLevelID = atoi(value);
+            else if (strcmp(name, "--id-base") == 0)    options.idBase = atoi(value);
+            else if (strcmp(name, "--seed") == 0)       options.seed = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+            else if (strcmp(name, "--enemy-type") == 0) options.enemyType = value;
+            else if (strcmp(name, "--output") == 0)     options.outputPath = value;
+            else if (strcmp(name, "--layout") == 0)
+            {
+                if      (strcmp(value, "scatter") == 0) options.layout = Layout::Scatter;
+                else if (strcmp(value, "grid") == 0)    options.layout = Layout::Grid;
+                else if (strcmp(value, "rooms") == 0)   options.layout = Layout::Rooms;
+                else return false;
+            }
+            else return false;
+        }
+
+        // Has to match a name in Enemies::enemyMap
+        const char* enemyTypes[] = { "Fast", "Brute", "Boss", "Tutorial" };
+        if (std::find(std::begin(enemyTypes), std::end(enemyTypes), options.enemyType) == std::end(enemyTypes))
+        {
+            std::cerr << "Unknown enemy type " << options.enemyType << '\n';
+            return false;
+        }
+
+        if (options.idBase < 0) options.idBase = options.levelID * 100;
+        if (options.outputPath.empty()) options.outputPath = "level_" + std::to_string(options.levelID) + ".json";
+
+        // IDs are stored as uint16_t by the game
+        int maxCount = std::max({ options.enemyCount, options.ammoCrateCount, options.keyCount });
+        if (options.levelID < 0 || options.levelID > 65535 || options.idBase + maxCount > 65536)
+        {
+            std::cerr << "Level and object IDs have to fit in 16 bits!" << '\n';
+            return false;
+        }
+
+        return options.wallCount >= 0 && options.enemyCount >= 0 && options.ammoCrateCount >= 0 && options.keyCount >= 0;
+    }
+
+    //-----------------------------------------------------------------------------
+    // Adds screen border with a doorway on the right edge, same as most
+    // shipped levels
+    //-----------------------------------------------------------------------------
+    void AddBorder(Level& level)
+    {
+        const int t = BORDER_THICKNESS;
+        level.walls.push_back({ 0, 0, t, WINDOW_HEIGHT });
+        level.walls.push_back({ WINDOW_WIDTH - t, 0, t, DOOR_START });
+        level.walls.push_back({ WINDOW_WIDTH - t, DOOR_END, t, WINDOW_HEIGHT - DOOR_END });
+        level.walls.push_back({ t, 0, WINDOW_WIDTH - 2 * t, t });
+        level.walls.push_back({ t, WINDOW_HEIGHT - t, WINDOW_WIDTH - 2 * t, t });
+    }
+
+    //-----------------------------------------------------------------------------
+    // True if a wall would block the players spawn points
+    //-----------------------------------------------------------------------------
+    bool IsInClearArea(const LevelRect& rect)
+    {
+        const int minX = EDGE_CLEARANCE;
+        const int minY = EDGE_CLEARANCE;
+        const int maxX = WINDOW_WIDTH - EDGE_CLEARANCE;
+        const int maxY = WINDOW_HEIGHT - EDGE_CLEARANCE;
+
+        if (rect.x < minX || rect.y < minY || rect.x + rect.width > maxX || rect.y + rect.height > maxY)
+            return true;
+
+        // Closest point on rect to screen center
+        const float centerX = WINDOW_WIDTH / 2.0f;
+        const float centerY = WINDOW_HEIGHT / 2.0f;
+        float closestX = std::fmax(static_cast<float>(rect.x), std::fmin(centerX, static_cast<float>(rect.x + rect.width)));
+        float closestY = std::fmax(static_cast<float>(rect.y), std::fmin(centerY, static_cast<float>(rect.y + rect.height)));
+
+        return std::hypot(closestX - centerX, closestY - centerY) < CENTER_CLEARANCE;
+    }
+
+    //-----------------------------------------------------------------------------
+    // True if rect overlaps any wall already in level
+    //-----------------------------------------------------------------------------
+    bool OverlapsWall(const Level& level, const LevelRect& rect)
+    {
+        for (const LevelRect& wall : level.walls)
+        {
+            if (rect.x < wall.x + wall.width && rect.x + rect.width > wall.x &&
+                rect.y < wall.y + wall.height && rect.y + rect.height > wall.y)
+                return true;
+        }
+        return false;
+    }
+
+    //-----------------------------------------------------------------------------
+    // Finds the biggest cell size that fits at least capacity cells on
+    // screen, the grid doesn't divide the screen evenly so the first guess
+    // can come up short
+    //-----------------------------------------------------------------------------
+    float FindCellSize(int width, int height, float capacity)
+    {
+        float cellSize = std::sqrt(static_cast<float>(width) * height / std::max(capacity, 1.0f));
+        while (cellSize > 1.0f && static_cast<int>(width / cellSize) * static_cast<int>(height / cellSize) < capacity)
+        {
+            cellSize *= 0.98f;
+        }
+        return cellSize;
+    }
+
+
+    //-----------------------------------------------------------------------------
+    // Scatter layout, blocks get smaller as the wall count goes up so the
+    // screen doesn't fill up completely
+    //-----------------------------------------------------------------------------
+    void AddScatterWalls(Level& level, int count, std::mt19937& rng)
+    {
+        const float area = static_cast<float>((WINDOW_WIDTH - 2 * EDGE_CLEARANCE) * (WINDOW_HEIGHT - 2 * EDGE_CLEARANCE));
+        const int maxSize = std::max(2, static_cast<int>(std::sqrt(area / std::max(count, 1)) * 0.6f));
+
+        std::uniform_int_distribution<int> x(EDGE_CLEARANCE, WINDOW_WIDTH - EDGE_CLEARANCE);
+        std::uniform_int_distribution<int> y(EDGE_CLEARANCE, WINDOW_HEIGHT - EDGE_CLEARANCE);
+        std::uniform_int_distribution<int> size(std::max(1, maxSize / 4), maxSize);
+
+        // Gives up on a wall after enough misses instead of looping forever
+        int misses = 0;
+        while (count > 0 && misses < 1000)
+        {
+            LevelRect wall = { x(rng), y(rng), size(rng), size(rng) };
+            if (IsInClearArea(wall))
+            {
+                misses++;
+                continue;
+            }
+
+            level.walls.push_back(wall);
+            count--;
+            misses = 0;
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    // Grid layout, one pillar per cell and skips cells in clear areas,
+    // so the grid is made a bit bigger than count
+    //-----------------------------------------------------------------------------
+    void AddGridWalls(Level& level, int count)
+    {
+        if (count <= 0) return;
+
+        const int width = WINDOW_WIDTH - 2 * EDGE_CLEARANCE;
+        const int height = WINDOW_HEIGHT - 2 * EDGE_CLEARANCE;
+        const float cellSize = FindCellSize(width, height, count * 1.06f);
+        const int columns = std::max(1, static_cast<int>(width / cellSize));
+        const int rows = std::max(1, static_cast<int>(height / cellSize));
+        const int pillarSize = std::max(1, static_cast<int>(cellSize * 0.4f));
+
+        for (int row = 0; row < rows && count > 0; row++)
+        {
+            for (int column = 0; column < columns && count > 0; column++)
+            {
+                LevelRect wall = {
+                    EDGE_CLEARANCE + static_cast<int>((column + 0.3f) * cellSize),
+                    EDGE_CLEARANCE + static_cast<int>((row + 0.3f) * cellSize),
+                    pillarSize,
+                    pillarSize
+                };
+                if (IsInClearArea(wall)) continue;
+
+                level.walls.push_back(wall);
+                count--;
+            }
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    // Rooms layout, every room has a wall on its right and bottom side and
+    // every wall is split in two by a doorway at a random spot
+    //-----------------------------------------------------------------------------
+    void AddRoomWalls(Level& level, int count, std::mt19937& rng)
+    {
+        if (count <= 0) return;
+
+        const int width = WINDOW_WIDTH - 2 * EDGE_CLEARANCE;
+        const int height = WINDOW_HEIGHT - 2 * EDGE_CLEARANCE;
+
+        // Four walls per room, some end up in the clear areas
+        const float roomSize = FindCellSize(width, height, count / 4.0f * 1.3f);
+        const int columns = std::max(1, static_cast<int>(width / roomSize));
+        const int rows = std::max(1, static_cast<int>(height / roomSize));
+        const int thickness = std::max(1, static_cast<int>(roomSize * 0.08f));
+        const int door = std::max(1, static_cast<int>(roomSize * 0.35f));
+        const int roomLength = static_cast<int>(roomSize);
+
+        std::uniform_int_distribution<int> doorPosition(0, std::max(0, roomLength - door));
+
+        // Splits a wall at a random doorway, wall is skipped if it ends up in a clear area
+        auto addSplitWall = [&](int x, int y, bool vertical)
+        {
+            int doorStart = doorPosition(rng);
+            LevelRect first, second;
+            if (vertical)
+            {
+                first  = { x, y, thickness, doorStart };
+                second = { x, y + doorStart + door, thickness, roomLength - doorStart - door };
+            }
+            else
+            {
+                first  = { x, y, doorStart, thickness };
+                second = { x + doorStart + door, y, roomLength - doorStart - door, thickness };
+            }
+
+            for (const LevelRect& wall : { first, second })
+            {
+                if (count <= 0 || wall.width <= 0 || wall.height <= 0 || IsInClearArea(wall)) continue;
+
+                level.walls.push_back(wall);
+                count--;
+            }
+        };
+
+        for (int row = 0; row < rows && count > 0; row++)
+        {
+            for (int column = 0; column < columns && count > 0; column++)
+            {
+                int x = EDGE_CLEARANCE + static_cast<int>(column * roomSize);
+                int y = EDGE_CLEARANCE + static_cast<int>(row * roomSize);
+
+                addSplitWall(x + roomLength - thickness, y, true);
+                addSplitWall(x, y + roomLength - thickness, false);
+            }
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    // Places enemies with a horizontal or vertical patrol path, enemies are
+    // kept away from the middle of the screen and their whole path out of walls
+    // Returns false if an enemy didn't fit anywhere
+    //-----------------------------------------------------------------------------
+    bool AddEnemies(Level& level, int count, std::mt19937& rng)
+    {
+        std::uniform_int_distribution<int> x(EDGE_CLEARANCE, WINDOW_WIDTH - EDGE_CLEARANCE);
+        std::uniform_int_distribution<int> y(EDGE_CLEARANCE, WINDOW_HEIGHT - EDGE_CLEARANCE);
+        std::uniform_int_distribution<int> pathLength(-400, 400);
+        std::bernoulli_distribution horizontal(0.5);
+
+        // Dense levels may have no gap as wide as a hitbox, then only the
+        // path itself is kept out of walls
+        int clearance = ENEMY_RADIUS;
+        int attempts = 0;
+        while (count > 0)
+        {
+            if (attempts++ >= MAX_PLACEMENT_ATTEMPTS)
+            {
+                if (clearance == 0) return false;
+                clearance = 0;
+                attempts = 0;
+            }
+
+            int startX = x(rng);
+            int startY = y(rng);
+            if (std::hypot(startX - WINDOW_WIDTH / 2.0f, startY - WINDOW_HEIGHT / 2.0f) < ENEMY_CENTER_CLEARANCE) continue;
+
+            int endX = startX;
+            int endY = startY;
+            if (horizontal(rng))
+                endX = std::clamp(startX + pathLength(rng), EDGE_CLEARANCE, WINDOW_WIDTH - EDGE_CLEARANCE);
+            else
+                endY = std::clamp(startY + pathLength(rng), EDGE_CLEARANCE, WINDOW_HEIGHT - EDGE_CLEARANCE);
+
+            // Area the hitbox sweeps along the path
+            const LevelRect swept = {
+                std::min(startX, endX) - clearance,
+                std::min(startY, endY) - clearance,
+                std::abs(endX - startX) + 2 * clearance,
+                std::abs(endY - startY) + 2 * clearance
+            };
+            if (OverlapsWall(level, swept)) continue;
+
+            level.enemyPaths.push_back({ startX, startY, endX, endY });
+            count--;
+            attempts = 0;
+        }
+
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+    // Places pickups of width by height at random positions that don't
+    // overlap a wall, returns false if a pickup didn't fit anywhere
+    //-----------------------------------------------------------------------------
+    bool AddPickups(const Level& level, std::vector<LevelRect>& pickups, int count, int width, int height, std::mt19937& rng)
+    {
+        std::uniform_int_distribution<int> x(EDGE_CLEARANCE, WINDOW_WIDTH - EDGE_CLEARANCE - width);
+        std::uniform_int_distribution<int> y(EDGE_CLEARANCE, WINDOW_HEIGHT - EDGE_CLEARANCE - height);
+
+        for (int i = 0; i < count; i++)
+        {
+            LevelRect pickup;
+            int attempts = 0;
+            do
+            {
+                if (attempts++ >= MAX_PLACEMENT_ATTEMPTS) return false;
+                pickup = { x(rng), y(rng), width, height };
+            } while (OverlapsWall(level, pickup));
+
+            pickups.push_back({ pickup.x, pickup.y, 0, 0 });
+        }
+
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+    // Writes level in the format Game::LoadLevel reads, one object per line
+    // so huge levels stay reasonably small
+    //-----------------------------------------------------------------------------
+    bool WriteLevel(const Level& level, const Options& options)
+    {
+        FILE* file = fopen(options.outputPath.c_str(), "w");
+        if (file == nullptr)
+        {
+            std::cerr << "Failed to open " << options.outputPath << " for writing!" << '\n';
+            return false;
+        }
+
+        fprintf(file, "{\n    \"walls\": [");
+        for (size_t i = 0; i < level.walls.size(); i++)
+        {
+            const LevelRect& wall = level.walls[i];
+            fprintf(file, "%s\n        { \"x\": %d, \"y\": %d, \"width\": %d, \"height\": %d }",
+                i == 0 ? "" : ",", wall.x, wall.y, wall.width, wall.height);
+        }
+
+        fprintf(file, "\n    ],\n    \"enemies\": [");
+        for (size_t i = 0; i < level.enemyPaths.size(); i++)
+        {
+            const LevelRect& path = level.enemyPaths[i];
+            fprintf(file, "%s\n        { \"type\": \"%s\", \"pathStartX\": %d, \"pathStartY\": %d, \"pathEndX\": %d, \"pathEndY\": %d, \"ID\": %d }",
+                i == 0 ? "" : ",", options.enemyType.c_str(), path.x, path.y, path.width, path.height, options.idBase + static_cast<int>(i));
+        }
+
+        fprintf(file, "\n    ],\n    \"ammoCrates\": [");
+        for (size_t i = 0; i < level.ammoCrates.size(); i++)
+        {
+            const LevelRect& crate = level.ammoCrates[i];
+            fprintf(file, "%s\n        { \"x\": %d, \"y\": %d, \"ammoCount\": 4, \"ID\": %d }",
+                i == 0 ? "" : ",", crate.x, crate.y, options.idBase + static_cast<int>(i));
+        }
+
+        fprintf(file, "\n    ],\n    \"keys\": [");
+        for (size_t i = 0; i < level.keys.size(); i++)
+        {
+            const LevelRect& key = level.keys[i];
+            fprintf(file, "%s\n        { \"x\": %d, \"y\": %d, \"ID\": %d }",
+                i == 0 ? "" : ",", key.x, key.y, options.idBase + static_cast<int>(i));
+        }
+
+        // Exit in the right border doorway, locked by the first key
+        fprintf(file, "\n    ],\n    \"transitionBoxes\": [\n        { \"x\": %d, \"y\": %d, \"width\": %d, \"height\": %d, \"nextLevelID\": %d, \"keyID\": %d }\n    ],\n",
+            WINDOW_WIDTH - BORDER_THICKNESS, DOOR_START, BORDER_THICKNESS, DOOR_END - DOOR_START, options.nextLevelID, options.idBase);
+
+        fprintf(file, "    \"texts\": []\n}\n");
+
+        bool ok = ferror(file) == 0;
+        fclose(file);
+
+        if (!ok) std::cerr << "Failed to write " << options.outputPath << '\n';
+        return ok;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Generates a level from the command line options and writes it to a file
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    if (options.keyCount == 0)
+        std::cerr << "Warning: level has no keys, so the exit can never be opened" << '\n';
+
+    std::mt19937 rng(options.seed);
+    Level level;
+
+    AddBorder(level);
+    const int layoutWalls = std::max(0, options.wallCount - static_cast<int>(level.walls.size()));
+
+    switch (options.layout)
+    {
+    case Layout::Scatter: AddScatterWalls(level, layoutWalls, rng); break;
+    case Layout::Grid:    AddGridWalls(level, layoutWalls);         break;
+    case Layout::Rooms:   AddRoomWalls(level, layoutWalls, rng);    break;
+    }
+
+    // A key stuck in a wall could make the level impossible to finish
+    if (!AddPickups(level, level.keys, options.keyCount, KEY_SIZE, KEY_SIZE, rng))
+    {
+        std::cerr << "Couldn't find room for every key outside the walls, try fewer walls" << '\n';
+        return 1;
+    }
+
+    if (!AddEnemies(level, options.enemyCount, rng))
+        std::cerr << "Warning: only found room for " << level.enemyPaths.size() << " of " << options.enemyCount << " enemies" << '\n';
+    if (!AddPickups(level, level.ammoCrates, options.ammoCrateCount, AMMO_CRATE_WIDTH, AMMO_CRATE_HEIGHT, rng))
+        std::cerr << "Warning: only found room for " << level.ammoCrates.size() << " of " << options.ammoCrateCount << " ammo crates" << '\n';
+
+    if (!WriteLevel(level, options)) return 1;
+
+    std::cout << "Wrote " << options.outputPath << " with " << level.walls.size() << " walls, "
+        << level.enemyPaths.size() << " enemies, " << level.ammoCrates.size() << " ammo crates and "
+        << level.keys.size() << " keys" << '\n';
+
+    // Clear areas can leave some walls unplaced, mostly with very high wall counts
+    if (static_cast<int>(level.walls.size()) < options.wallCount)
+        std::cerr << "Warning: only placed " << level.walls.size() << " of " << options.wallCount << " walls" << '\n';
+
+    return 0;
+}